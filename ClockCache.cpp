@@ -0,0 +1,144 @@
+#include "ClockCache.hpp"
+#include<iostream>
+#include<cstdlib>
+#include<chrono>
+#include<algorithm>
+
+ClockCache::ClockCache(std::size_t capacity_, std::size_t tableSize_, PROBE_TYPE pType,
+    bool doCompact, double compactionFloor):
+    HashTableDictionary(tableSize_, pType, doCompact, compactionFloor),
+    CAPACITY{capacity_}, handStep{1} {
+
+    if (pType == ROBIN_HOOD) {
+        std::cout << "ClockCache needs keys that stay in their slots; ROBIN_HOOD moves them. Terminating\n";
+        exit(1);
+    }
+    // At least one slot must stay free so that a probe sequence always ends.
+    if (CAPACITY == 0 || CAPACITY >= TABLE_SIZE) {
+        std::cout << "ClockCache capacity " << CAPACITY << " does not fit a table of size "
+                  << TABLE_SIZE << ". Terminating\n";
+        exit(1);
+    }
+    referenced.resize(TABLE_SIZE, 0);
+    handStep = std::max<std::size_t>(1, static_cast<std::size_t>(HAND_STRIDE * static_cast<double>(TABLE_SIZE)));
+}
+
+void ClockCache::clear() {
+    HashTableDictionary::clear();
+
+    referenced.assign(TABLE_SIZE, 0);
+    hand = 0;
+
+    evictedKey.clear();
+    evictedLast = false;
+
+    numCacheHits = 0;
+    numCacheMisses = 0;
+    numEvictions = 0;
+    numHandSteps = 0;
+}
+
+bool ClockCache::get(std::string_view key) {
+    const ProbeResult probe = memberHelper(key);
+    numLookups++;
+    if (!probe.found) {
+        numCacheMisses++;
+        return false;
+    }
+
+    numCacheHits++;
+    referenced[probe.idx] = 1;
+    return true;
+}
+
+bool ClockCache::put(std::string_view key) {
+    evictedLast = false;
+
+    // The one probe sequence: it either finds key or the slot key goes into.
+    const ProbeResult probe = memberHelper(key, PROBE_INSERT);
+    if (probe.found) {
+        numCacheHits++;
+        referenced[probe.idx] = 1;
+        return true;
+    }
+
+    numCacheMisses++;
+    // The victim is USED, so it can't be idx. Turning it into a tombstone
+    // leaves idx a valid place for key.
+    if (size() == CAPACITY)
+        evictAtHand();
+
+    placeKey(probe.idx, key, probe.hash);
+    referenced[probe.idx] = 1;
+
+    if (shouldCompact && effectiveLoadFactor() > compactionTriggerEffectiveRate) {
+        auto t0 = std::chrono::steady_clock::now();
+        compactCache();
+        auto t1 = std::chrono::steady_clock::now();
+        recordCompactionPause(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        numCompactions++;
+    }
+
+    return false;
+}
+
+bool ClockCache::erase(std::string_view key) {
+    const ProbeResult probe = memberHelper(key, PROBE_REMOVE);
+    if (!probe.found)
+        return false;
+
+    referenced[probe.idx] = 0;
+    vacateSlot(probe.idx);
+    return true;
+}
+
+void ClockCache::evictAtHand() {
+    // The cache is full, so there is a USED slot; at worst the hand clears
+    // every bit in one turn and takes the first slot it comes back to.
+    for (;;) {
+        const std::size_t idx = hand;
+        hand = advanceSlot(hand, handStep);
+        numHandSteps++;
+        if (hashTableMask[idx] != USED)
+            continue;
+        if (referenced[idx]) {
+            referenced[idx] = 0;
+            continue;
+        }
+
+        // Tombstones are never compared against, so the key can be moved out.
+        hashTable.takeKey(idx, evictedKey);
+        vacateSlot(idx);
+        numEvictions++;
+        evictedLast = true;
+        return;
+    }
+}
+
+void ClockCache::compactCache() {
+    // Same idea as HashTableDictionary::compactTable(), with each key's
+    // reference bit going along to its new slot. The hand keeps its index;
+    // in the rebuilt table that is as good a place to go on from as any.
+    KeyStore oldTable(TABLE_SIZE, keyStorage == ARENA);
+    std::vector<ELEMENT_STATUS> oldMask(TABLE_SIZE, AVAILABLE);
+    std::vector<std::uint64_t> oldHashes(TABLE_SIZE, 0);
+    std::vector<std::uint8_t> oldReferenced(TABLE_SIZE, 0);
+    hashTable.swap(oldTable);
+    hashTableMask.swap(oldMask);
+    slotHash.swap(oldHashes);
+    referenced.swap(oldReferenced);
+
+    numberOfTombstones = 0;
+
+    // The keys are distinct, so each one goes to the first free slot its
+    // stored hash code leads to; nothing is hashed or compared.
+    for (std::size_t i = 0; i < TABLE_SIZE; i++) {
+        if (oldMask[i] != USED)
+            continue;
+        const std::size_t idx = firstFreeSlot(oldHashes[i]);
+        hashTable.moveFrom(idx, oldTable, i);
+        slotHash[idx] = oldHashes[i];
+        hashTableMask[idx] = USED;
+        referenced[idx] = oldReferenced[i];
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef HASHTABLESOPENADDRESSING_CLOCKCACHE_HPP
+#define HASHTABLESOPENADDRESSING_CLOCKCACHE_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "HashTableDictionary.hpp"
+
+// A CLOCK (second-chance) cache of string keys in the open-addressed slots
+// of HashTableDictionary: an approximation of LRU with no recency list.
+// Every slot has a reference bit, kept as one byte per slot in a vector
+// of its own, parallel to hashTableMask. A hit sets the bit, and that is
+// all it does; there are no links to splice.
+//
+// To evict, a clock hand sweeps the slot array from where it last stopped.
+// A USED slot whose bit is set loses the bit and is passed over; the first
+// one whose bit is clear is the victim. A new key counts as referenced, so
+// it survives the hand's next pass.
+//
+// The hand does not step to the next slot but HAND_STRIDE of the table
+// ahead. The table size is prime, so it still comes round to every slot
+// once per turn. Stepping one slot at a time would leave the tombstones
+// of successive evictions side by side behind the hand, where SINGLE
+// probing's inserts mostly can't reuse them; the free slots would fill
+// up, and the clusters grow to thousands of slots between compactions.
+//
+// As in LruCache, the cache does its own compaction, since the reference
+// bits have to move with the keys, and the table is inherited non-publicly
+// so that nothing bypasses them.
+
+class ClockCache : protected HashTableDictionary {
+
+public:
+    ClockCache( std::size_t capacity_, std::size_t tableSize_,
+        PROBE_TYPE probeType, bool doCompact=true, double compactionTriggerRate=0.95);
+
+    using HashTableDictionary::size;
+    using HashTableDictionary::empty;
+    using HashTableDictionary::printStats;
+    using HashTableDictionary::csvStats;
+    using HashTableDictionary::csvStatsHeader;
+    using HashTableDictionary::setKeyStorage;   // before the first put()
+
+    // Returns true on a hit and marks key referenced.
+    bool get( std::string_view key );
+
+    // Returns true if key was already resident (and marks it referenced).
+    // On a miss key is inserted; if the cache is full, the clock hand
+    // evicts an entry first (see lastEvicted()).
+    bool put( std::string_view key );
+
+    bool erase( std::string_view key );
+
+    void clear();
+
+    [[nodiscard]] std::size_t capacity() const { return CAPACITY; }
+    [[nodiscard]] bool evictedOnLastPut() const { return evictedLast; }
+    [[nodiscard]] const std::string& lastEvicted() const { return evictedKey; }
+
+    [[nodiscard]] std::int64_t hits() const { return numCacheHits; }
+    [[nodiscard]] std::int64_t misses() const { return numCacheMisses; }
+    [[nodiscard]] std::int64_t evictions() const { return numEvictions; }
+    // Slots the hand has moved over, victims included.
+    [[nodiscard]] std::int64_t handSteps() const { return numHandSteps; }
+
+private:
+    std::size_t CAPACITY;
+
+    // One byte per slot rather than a packed bit, so a hit is a plain
+    // store and not a read-modify-write of a shared word.
+    std::vector<std::uint8_t> referenced;
+    std::size_t hand = 0;
+    std::size_t handStep;               // HAND_STRIDE of TABLE_SIZE, at least 1
+    static constexpr double HAND_STRIDE = 0.6180339887;
+
+    std::string evictedKey;
+    bool evictedLast = false;
+
+    std::int64_t numCacheHits = 0;
+    std::int64_t numCacheMisses = 0;
+    std::int64_t numEvictions = 0;
+    std::int64_t numHandSteps = 0;
+
+    void evictAtHand();
+    void compactCache();
+};
+
+
+#endif //HASHTABLESOPENADDRESSING_CLOCKCACHE_HPP
@@ -0,0 +1,185 @@
+#include "ConcurrentHashTableDictionary.hpp"
+#include<iostream>
+#include<iomanip>
+#include<algorithm>
+#include<cmath>
+
+ConcurrentHashTableDictionary::Shard::Shard(std::size_t tableSize_, PROBE_TYPE probeType, bool doCompact,
+    double compactionTriggerRate, COMPACTION_TYPE compactionType):
+    table(tableSize_, probeType, doCompact, compactionTriggerRate, compactionType) {
+    // A shard may get more than its share of the keys; it grows then.
+    table.setAutoResize(SHARD_GROW_LOAD);
+}
+
+ConcurrentHashTableDictionary::ConcurrentHashTableDictionary(std::size_t tableSize_, std::size_t numShards_,
+    PROBE_TYPE pType, bool doCompact, double compactionFloor, COMPACTION_TYPE cType) {
+    if (numShards_ == 0 || numShards_ > 0xFFFFFFFFu) {
+        std::cout << "A concurrent table needs 1 to 2^32 - 1 shards, not " << numShards_ << ". Terminating\n";
+        exit(1);
+    }
+    // Each shard can take its share of tableSize_ keys before it grows, so
+    // the shards hold as many as one table of tableSize_ slots would.
+    const auto share = static_cast<double>(tableSize_) / static_cast<double>(numShards_);
+    const std::size_t shardSize = std::max<std::size_t>(
+        nextPrime(static_cast<std::size_t>(std::ceil(share / SHARD_GROW_LOAD))), 16);
+    shards.reserve(numShards_);
+    for (std::size_t i = 0; i < numShards_; i++)
+        shards.push_back(std::make_unique<Shard>(shardSize, pType, doCompact, compactionFloor, cType));
+    shardMultiplier = fastmodMultiplier(static_cast<std::uint32_t>(numShards_));
+}
+
+void ConcurrentHashTableDictionary::setDeleteType(DELETE_TYPE type) {
+    for (auto& shard : shards)
+        shard->table.setDeleteType(type);
+}
+
+void ConcurrentHashTableDictionary::setKeyStorage(KEY_STORAGE type) {
+    for (auto& shard : shards)
+        shard->table.setKeyStorage(type);
+}
+
+ConcurrentHashTableDictionary::Shard& ConcurrentHashTableDictionary::shardFor(std::string_view v) {
+    const auto h = static_cast<std::uint32_t>(wyhash64(v, SHARD_SEED) >> 32);
+    return *shards[fastmod32(h, shardMultiplier, static_cast<std::uint32_t>(shards.size()))];
+}
+
+bool ConcurrentHashTableDictionary::insert(const std::string& v) {
+    Shard& shard = shardFor(v);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return shard.table.insert(v);
+}
+
+bool ConcurrentHashTableDictionary::insert(std::string&& v) {
+    Shard& shard = shardFor(v);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return shard.table.insert(std::move(v));
+}
+
+bool ConcurrentHashTableDictionary::emplace(std::string_view v) {
+    Shard& shard = shardFor(v);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return shard.table.emplace(v);
+}
+
+bool ConcurrentHashTableDictionary::member(std::string_view v) {
+    Shard& shard = shardFor(v);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return shard.table.member(v);
+}
+
+bool ConcurrentHashTableDictionary::remove(std::string_view v) {
+    Shard& shard = shardFor(v);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return shard.table.remove(v);
+}
+
+std::size_t ConcurrentHashTableDictionary::size() const {
+    std::size_t total = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        total += shard->table.size();
+    }
+    return total;
+}
+
+double ConcurrentHashTableDictionary::loadFactor() const {
+    std::size_t active = 0, slots = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        active += shard->table.size();
+        slots += shard->table.TABLE_SIZE;
+    }
+    return static_cast<double>(active) / static_cast<double>(slots);
+}
+
+bool ConcurrentHashTableDictionary::empty() const {
+    return size() == 0;
+}
+
+void ConcurrentHashTableDictionary::clear() {
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        shard->table.clear();
+    }
+}
+
+void ConcurrentHashTableDictionary::printStats() const {
+    const int width = 8;
+    std::cout << std::setw(width) << shards.size() << " shards." << std::endl;
+    for (std::size_t i = 0; i < shards.size(); i++) {
+        std::lock_guard<std::mutex> guard(shards[i]->lock);
+        std::cout << "\nShard " << i << ":\n";
+        shards[i]->table.printStats();
+    }
+}
+
+std::string ConcurrentHashTableDictionary::csvStats() {
+    // The sums of the shards' counters, in HashTableDictionary's columns.
+    std::int64_t tableSize = 0, active = 0, tombstones = 0, probes = 0, inserts = 0, deletes = 0, lookups = 0,
+        fullScans = 0, compactions = 0, maxInTable = 0, pauses = 0, maxPauseNs = 0, shifts = 0,
+        comparesAvoided = 0, resizes = 0;
+    std::size_t keyBytes = 0;
+    LengthHistogram probeLengths[NUM_PROBE_OPS];
+    ClusterStats clusters;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        const HashTableDictionary& t = shard->table;
+        t.flushProbeSample();
+        for (int op = 0; op < NUM_PROBE_OPS; op++)
+            probeLengths[op].merge(t.probeLengthsByOp[op]);
+        const ClusterStats shardClusters = t.clusterStats();
+        clusters.occupiedSlots += shardClusters.occupiedSlots;
+        clusters.runLengths.merge(shardClusters.runLengths);
+        tableSize += static_cast<std::int64_t>(t.TABLE_SIZE);
+        active += t.numberOfActive;
+        tombstones += t.numberOfTombstones;
+        probes += t.totalProbes;
+        inserts += t.numInserts;
+        deletes += t.numDeletes;
+        lookups += t.numLookups;
+        fullScans += t.numFullScans;
+        compactions += t.numCompactions;
+        maxInTable = std::max(maxInTable, t.maxValuesInTable);
+        pauses += t.numCompactionPauses;
+        maxPauseNs = std::max(maxPauseNs, t.maxCompactionPauseNs);
+        shifts += t.totalShifts;
+        comparesAvoided += t.numStringComparesAvoided;
+        resizes += t.numResizes;
+        keyBytes += t.hashTable.bytesUsed() + t.sourceTable.bytesUsed();
+    }
+
+    const HashTableDictionary& first = shards.front()->table;
+    const auto size = static_cast<double>(tableSize);
+    const std::int64_t available = tableSize - tombstones - active;
+    return std::to_string(tableSize) + "," + // table size
+           std::to_string(active) + "," + // active
+           std::to_string(available) + "," + // available
+           std::to_string(tombstones) + "," + // tombstones
+           std::to_string(probes) + "," + // totalProbes
+           std::to_string(inserts) + "," + // inserts
+           std::to_string(deletes) + "," + // deletes
+           std::to_string(lookups) + "," + // lookups
+           std::to_string(fullScans) + "," + // full scans
+           std::to_string(compactions) + "," + // compactions
+           std::to_string(maxInTable) + "," + // max_in_table, the largest shard's
+           std::to_string(static_cast<int>(static_cast<double>(available) / size * 100)) + "," + // ratio available
+           std::to_string(static_cast<int>(static_cast<double>(active) / size * 100)) + "," + // load factor
+           std::to_string(static_cast<int>(static_cast<double>(active + tombstones) / size * 100)) +
+           "," + // effective load factor
+           std::to_string(static_cast<int>(static_cast<double>(tombstones) / size * 100)) + "," + // ratio tombstones
+           std::to_string(static_cast<double>(probes) / static_cast<double>(inserts + deletes + lookups)) +
+           "," + first.probeTypeName() + "," +
+           (first.shouldCompact ? "compaction_on" : "compaction_off") +
+           ((first.compactionType == INCREMENTAL) ? ",incremental," :
+               (first.compactionType == IN_PLACE) ? ",in_place," : ",rebuild,") +
+           std::to_string(pauses) + "," + // compaction pauses
+           std::to_string(static_cast<double>(maxPauseNs) / 1e3) + "," + // longest pause of any shard
+           std::to_string(shifts) + // keys moved by robin hood or backward shift
+           (first.deleteType == BACKWARD_SHIFT ? ",backward_shift," : ",tombstone,") +
+           std::to_string(comparesAvoided) + "," + // string compares skipped on a hash mismatch
+           first.hashTypeName() +
+           (first.keyStorage == ARENA ? ",arena," : ",strings,") +
+           std::to_string(static_cast<double>(keyBytes) / static_cast<double>(std::max<std::int64_t>(active, 1))) +
+           "," + std::to_string(resizes) +
+           probeStatsCsv(probeLengths, clusters); // every shard's probes and runs together
+}
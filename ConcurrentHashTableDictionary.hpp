@@ -0,0 +1,78 @@
+#ifndef HASHTABLESOPENADDRESSING_CONCURRENTHASHTABLEDICTIONARY_HPP
+#define HASHTABLESOPENADDRESSING_CONCURRENTHASHTABLEDICTIONARY_HPP
+
+#include<vector>
+#include<string>
+#include<string_view>
+#include<memory>
+#include<mutex>
+#include <cstdint>
+
+#include "HashTableDictionary.hpp"
+
+// A HashTableDictionary that any number of threads may use at once. The
+// keys are split by hash across independent shards, each one a complete
+// HashTableDictionary behind its own mutex, so threads working on keys of
+// different shards never wait for each other. Each shard compacts itself
+// when its own trigger is crossed.
+//
+// The shard is picked with a seeded wyhash of the key, so it is unrelated
+// to the key's slot inside the shard. Shards are sized for an even share of
+// the keys, but the shares are never exactly even, so every shard also
+// grows and shrinks on its own (see HashTableDictionary::setAutoResize()).
+//
+// csvStats() adds the shards' counters up into HashTableDictionary's
+// columns; the maxima are the largest of the shards'.
+
+class ConcurrentHashTableDictionary : public HashTableCommon {
+
+public:
+    // The shards share tableSize_ evenly: each is sized so that its share
+    // of tableSize_ keys stays under the load at which it grows.
+    ConcurrentHashTableDictionary( std::size_t tableSize_, std::size_t numShards,
+        PROBE_TYPE probeType, bool doCompact=false, double compactionTriggerRate=0.95,
+        COMPACTION_TYPE compactionType=REBUILD );
+
+    // Call before the first insert; they apply to every shard.
+    void setDeleteType( DELETE_TYPE type );
+    void setKeyStorage( KEY_STORAGE type );
+
+    bool insert( const std::string& v );
+    bool insert( std::string&& v );
+    bool emplace( std::string_view v );
+    bool member( std::string_view v );
+    bool remove( std::string_view v );
+
+    // Each shard is locked in turn, so while other threads are writing
+    // these are a sum of per-shard snapshots.
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] std::size_t numShards() const { return shards.size(); }
+    // The shards' keys over the shards' slots, all together.
+    [[nodiscard]] double loadFactor() const;
+
+    void clear();
+    void printStats() const;
+    std::string csvStats();
+
+private:
+    static constexpr std::uint64_t SHARD_SEED = 0x9E3779B97F4A7C15ULL;
+    static constexpr double SHARD_GROW_LOAD = 0.9;
+
+    // One cache line at least, so that two shards' locks never share one.
+    struct alignas(64) Shard {
+        mutable std::mutex lock;
+        HashTableDictionary table;
+
+        Shard( std::size_t tableSize_, PROBE_TYPE probeType, bool doCompact,
+            double compactionTriggerRate, COMPACTION_TYPE compactionType );
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::uint64_t shardMultiplier;      // fastmod multiplier for shards.size()
+
+    Shard& shardFor( std::string_view v );
+};
+
+
+#endif //HASHTABLESOPENADDRESSING_CONCURRENTHASHTABLEDICTIONARY_HPP
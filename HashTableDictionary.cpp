@@ -7,32 +7,191 @@
 #include<iomanip>
 #include<algorithm>
 #include<cassert>
+#include<chrono>
+#include<cmath>
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::BasicHashTableDictionary(std::size_t tableSize_, PROBE_TYPE pType, bool doCompact, double compactionFloor,
+    COMPACTION_TYPE cType, std::size_t slotsPerStep):
+    TABLE_SIZE{nextPrime(tableSize_)}, probeType{ProbePolicy::resolve(pType)}, compactionTriggerEffectiveRate(compactionFloor), shouldCompact {doCompact},
+    compactionType{cType}, compactionSlotsPerStep{std::max<std::size_t>(slotsPerStep, 1)} {
+    if (probeType != pType) {
+        std::cout << "This table is built for " << probeTypeName() << " probing only. Terminating\n";
+        exit(1);
+    }
+    setTableSize(TABLE_SIZE);
+    initialTableSize = TABLE_SIZE;
 
-HashTableDictionary::HashTableDictionary(std::size_t large, PROBE_TYPE pType, bool doCompact, double compactionFloor):
-    TABLE_SIZE{large}, probeType{pType}, compactionTriggerEffectiveRate(compactionFloor), shouldCompact {doCompact} {
-    hashTable.resize(large);
+    const std::size_t large = TABLE_SIZE;
+    hashTable = KeyStore(large, false);
     hashTableMask.resize(large, AVAILABLE);
+    slotHash.resize(large, 0);
+    if (probe() == ROBIN_HOOD)
+        probeDistance.resize(large, 0);
+
+    // Incremental compaction drains into a second table. It is allocated
+    // here, not when a compaction starts, so that starting one is O(1).
+    if (shouldCompact && compactionType == INCREMENTAL) {
+        sourceTable = KeyStore(large, false);
+        sourceTableMask.resize(large, AVAILABLE);
+        sourceSlotHash.resize(large, 0);
+    }
+    sourceRange = liveRange();
+    compactionCursor = sourceTableMask.size();
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::setTableSize(std::size_t tableSize_) {
+    // homeSlot() and probeStep() reduce 32-bit halves of the hash code.
+    if (tableSize_ > 0xFFFFFFFFu) {
+        std::cout << "Table size " << tableSize_ << " does not fit in 32 bits. Terminating\n";
+        exit(1);
+    }
+    TABLE_SIZE = tableSize_;
+    tableSizeMultiplier = fastmodMultiplier(static_cast<std::uint32_t>(TABLE_SIZE));
+    stepRangeMultiplier = fastmodMultiplier(static_cast<std::uint32_t>(TABLE_SIZE - 1));
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::setDeleteType(DELETE_TYPE type) {
+    if (type == BACKWARD_SHIFT && probe() != SINGLE) {
+        std::cout << "Backward-shift deletion needs SINGLE probing. Terminating\n";
+        exit(1);
+    }
+    deleteType = type;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::setHashType(HASH_TYPE type) {
+    if (HashPolicy::resolve(type) != type) {
+        std::cout << "This table is built for the " << hashTypeName() << " hash only. Terminating\n";
+        exit(1);
+    }
+    if (type == POLYNOMIAL && growLoadFactor != 0.0) {
+        std::cout << "Resizing needs the WYHASH hash. Terminating\n";
+        exit(1);
+    }
+    hashType = type;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::setAutoResize(double growAt, double shrinkAt) {
+    // shrinkAt < growAt / 2 so that a table just resized one way is not
+    // due to be resized back.
+    if (growAt <= 0.0 || growAt >= 1.0 || shrinkAt < 0.0 || shrinkAt >= growAt / 2) {
+        std::cout << "Resizing needs 0 < growAt < 1 and 0 <= shrinkAt < growAt / 2. Terminating\n";
+        exit(1);
+    }
+    if (hasher() == POLYNOMIAL) {
+        std::cout << "Resizing needs the WYHASH hash. Terminating\n";
+        exit(1);
+    }
+    growLoadFactor = growAt;
+    shrinkLoadFactor = shrinkAt;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::setKeyStorage(KEY_STORAGE type) {
+    keyStorage = type;
+    hashTable = KeyStore(TABLE_SIZE, keyStorage == ARENA);
+    if (sourceTable.size() != 0)
+        sourceTable = KeyStore(TABLE_SIZE, keyStorage == ARENA);
+}
+
+std::size_t HashTableCommon::nextPrime(std::size_t n) {
+    // The smallest prime >= n, by trial division; it runs once per table.
+    if (n <= 2)
+        return 2;
+    if (n % 2 == 0)
+        n++;
+    for (;; n += 2) {
+        bool isPrime = true;
+        for (std::size_t d = 3; d * d <= n; d += 2)
+            if (n % d == 0) {
+                isPrime = false;
+                break;
+            }
+        if (isPrime)
+            return n;
+    }
+}
+
+std::size_t HashTableCommon::tableSizeForCapacity(std::size_t N) {
+    // The sizes the report's runs used, kept so those numbers can be
+    // reproduced. Any other N gets the first prime past N * 5/4.
+    static const std::vector<std::pair<std::size_t, std::size_t>> N_and_primes = {
+        /* N = 2^10 = 1,024  */ { 1024,    1279    },
+        /* N = 2^11 = 2,048  */ { 2048,    2551    },
+        /* N = 2^12 = 4,096  */ { 4096,    5101    },
+        /* N = 2^13 = 8,192  */ { 8192,   10273   },
+        /* N = 2^14 = 16,384 */ { 16384,   20479   },
+        /* N = 2^15 = 32,768 */ { 32768,   40849   },
+        /* N = 2^16 = 65,536 */ { 65536,   81931   },
+        /* N = 2^17 = 131,072*/ { 131072,  163861  },
+        /* N = 2^18 = 262,144*/ { 262144,  327739  },
+        /* N = 2^19 = 524,288*/ { 524288,  655243  },
+        /* N = 2^20 = 1,048,576*/{ 1048576, 1310809 }
+    };
+
+    for (auto item: N_and_primes) {
+        if (item.first == N)
+            return item.second;
+    }
+    return nextPrime(N + N / 4 + 1);
 }
 
-void HashTableDictionary::clear() {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::clear() {
     //std::cout << "Clearing hash table...\n";
-    hashTable.clear();
+    if (TABLE_SIZE != initialTableSize) {
+        setTableSize(initialTableSize);
+        hashTable = KeyStore(TABLE_SIZE, keyStorage == ARENA);
+    } else {
+        hashTable.reset();
+    }
     hashTableMask.clear();
 
-    hashTable.resize(TABLE_SIZE);
     hashTableMask.resize(TABLE_SIZE, AVAILABLE);
+    slotHash.assign(TABLE_SIZE, 0);
+    if (probe() == ROBIN_HOOD)
+        probeDistance.assign(TABLE_SIZE, 0);
+
+    compacting = false;
+    resizing = false;
+    if (shouldCompact && compactionType == INCREMENTAL) {
+        sourceTableMask.assign(TABLE_SIZE, AVAILABLE);
+        if (sourceTable.size() == TABLE_SIZE)
+            sourceTable.reset();
+        else
+            sourceTable = KeyStore(TABLE_SIZE, keyStorage == ARENA);
+        sourceSlotHash.assign(TABLE_SIZE, 0);
+    } else {
+        sourceTable = KeyStore();
+        sourceTableMask.clear();
+        sourceSlotHash.clear();
+    }
+    sourceRange = liveRange();
+    compactionCursor = sourceTableMask.size();
 
      numLookups = 0;
      numDeletes = 0;
      numInserts = 0;
 
      numCompactions = 0;
+     numResizes = 0;
+     numCompactionPauses = 0;
+     maxCompactionPauseNs = 0;
 
      numHits = 0;
      numMisses = 0;
      numFullScans = 0;
 
      totalProbes = 0;
+     pendingProbes = 0;
+     for (auto& lengths : probeLengthsByOp)
+         lengths.clear();
+     totalShifts = 0;
+     numStringComparesAvoided = 0;
 
      numberOfActive = 0;
      numberOfTombstones = 0;
@@ -42,79 +201,438 @@ void HashTableDictionary::clear() {
 
 }
 
-double HashTableDictionary::effectiveLoadFactor() const {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+double BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::effectiveLoadFactor() const {
     return static_cast<double>(numberOfTombstones + numberOfActive) / static_cast<double>(TABLE_SIZE);
 }
 
 
-bool HashTableDictionary::insert( const std::string&  v ) {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+bool BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::insert( const std::string&  v ) {
+    return insertKey(std::string_view(v), hashCode(v));
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+bool BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::insert(std::string&& v) {
+    const std::uint64_t hash = hashCode(v);
+    return insertKey(std::move(v), hash);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+bool BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::emplace(std::string_view v) {
+    return insertKey(v, hashCode(v));
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+template<class Key>
+bool BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::insertKey(Key&& v, std::uint64_t hash) {
     // Returns whether the insert was successful.
+    beginOp(PROBE_INSERT);
 
-    if( numberOfActive == TABLE_SIZE) {
-        std::cout << "Table is full. This is a serious problem. Terminating\n";
-        printStats();
-        exit(1);
+    if (static_cast<std::size_t>(numberOfActive) == TABLE_SIZE) {
+        growFullTable();
+        // A POLYNOMIAL code was made for the old table size.
+        if (hasher() == POLYNOMIAL)
+            hash = hashCode(std::string_view(v));
+    }
+    if (probe() == ROBIN_HOOD) {
+        if (!robinHoodInsert(std::forward<Key>(v), hash))
+            return false;
+        compactionStep();
+        maybeResize();
+        return true;
     }
     // std::cout << v << std::endl;
-    const std::size_t idx = memberHelper(v);
-    if (hashTableMask.at(idx) == USED && hashTable.at(idx) == v)
+    const ProbeResult probe = probeFor(v, hash, liveRange(), hashTable, hashTableMask, slotHash);
+    if (probe.found)
+        return false;
+    if (compacting && findInCompactionSource(v, probe.hash) != sourceTable.size())
         return false;
 
-    assert(hashTableMask.at(idx) != USED);
-
-    hashTable.at(idx) = v;
-    if (hashTableMask.at(idx) == DELETED)
-        numberOfTombstones--;
-    hashTableMask.at(idx) = USED;
-    numberOfActive++;
-    numInserts++;
-
-    if (maxValuesInTable < numberOfActive)
-        maxValuesInTable = numberOfActive;
+    assert(hashTableMask.at(probe.idx) != USED);
 
+    placeKey(probe.idx, std::forward<Key>(v), probe.hash);
 
-    if (shouldCompact && effectiveLoadFactor() > compactionTriggerEffectiveRate) {
+    // Moves a few keys along if a resize or an incremental compaction is
+    // draining a table; otherwise it returns at once. A resize that is due
+    // goes before a compaction: the fresh table has no tombstones, and a
+    // compaction started first would keep putting the resize off.
+    compactionStep();
+    maybeResize();
+    if (shouldCompact && compactionType == INCREMENTAL) {
+        if (!compacting && effectiveLoadFactor() > compactionTriggerEffectiveRate) {
+            startCompaction();
+            numCompactions++;
+        }
+    } else if (shouldCompact && effectiveLoadFactor() > compactionTriggerEffectiveRate) {
        // std::cout << "Compacting the table with effective rate at: "
        //     << compactionTriggerEffectiveRate << std::endl;
         //printStats();
-        compactTable();
+        const std::int64_t t0 = pauseClockNs();
+        if (compactionType == IN_PLACE)
+            compactInPlace();
+        else
+            compactTable();
+        recordCompactionPause(pauseClockNs() - t0);
         numCompactions++;
     }
 
     return true;
 }
 
-std::size_t HashTableDictionary::size() const {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+std::size_t BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::size() const {
     return numberOfActive;
 }
 
-bool HashTableDictionary::remove(const std::string& v) {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+bool BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::remove(std::string_view v) {
+    return removeKey(v, hashCode(v));
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+bool BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::removeKey(std::string_view v, std::uint64_t hash) {
 //    std::cout << "In remove. Removing: " << v << std::endl;
-    auto idx = memberHelper(v);
-    if( hashTableMask.at(idx) != USED )
-        return false;
+    beginOp(PROBE_REMOVE);
+    if (probe() == ROBIN_HOOD) {
+        if (!robinHoodRemove(v, hash))
+            return false;
+        compactionStep();
+        maybeResize();
+        return true;
+    }
+    const ProbeResult probe = probeFor(v, hash, liveRange(), hashTable, hashTableMask, slotHash);
+    if( !probe.found ) {
+        if (!compacting || !removeFromCompactionSource(v, probe.hash))
+            return false;
+        compactionStep();
+        maybeResize();
+        return true;
+    }
 
-    if (numberOfActive == TABLE_SIZE && hashTable.at(idx) != v) {
-        std::cout << "Returning from remove because table is full and the item is not in the table.\n";
-        return false;
+    const std::size_t idx = probe.idx;
+    if (deleteType == BACKWARD_SHIFT) {
+        backwardShift(idx);
+        numberOfActive--;
+        numDeletes++;
+    } else {
+        vacateSlot(idx);
     }
 
+    compactionStep();
+    maybeResize();
+
+    return true;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::backwardShift(std::size_t hole) {
+    // Knuth's Algorithm R for linear probing. Walk the rest of the cluster.
+    // A key may move back into the hole unless its home slot lies cyclically
+    // in (hole, next], because then the hole is not on its probe path. The
+    // final hole becomes AVAILABLE.
+    std::size_t next = advanceSlot(hole, 1);
+    while (hashTableMask.at(next) == USED) {
+        const std::size_t home = homeSlot(slotHash.at(next));
+        const bool staysPut = hole <= next ? (hole < home && home <= next)
+                                           : (hole < home || home <= next);
+        if (!staysPut) {
+            hashTable.swapSlots(hole, next);
+            slotHash.at(hole) = slotHash.at(next);
+            hashTableMask.at(hole) = USED;
+            hole = next;
+            totalShifts++;
+        }
+        next = advanceSlot(next, 1);
+    }
+    // The swaps carried the removed key along to the final hole.
+    hashTable.release(hole);
+    hashTableMask.at(hole) = AVAILABLE;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::placeKey(std::size_t idx, std::string_view v, std::uint64_t hash) {
+    // Pre-condition: idx came from memberHelper() and is not USED.
+    hashTable.assign(idx, v);
+    occupySlot(idx, hash);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::placeKey(std::size_t idx, std::string&& v, std::uint64_t hash) {
+    hashTable.assign(idx, std::move(v));
+    occupySlot(idx, hash);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::occupySlot(std::size_t idx, std::uint64_t hash) {
+    slotHash.at(idx) = hash;
+    if (hashTableMask.at(idx) == DELETED)
+        numberOfTombstones--;
+    hashTableMask.at(idx) = USED;
+    numberOfActive++;
+    numInserts++;
+
+    if (maxValuesInTable < numberOfActive)
+        maxValuesInTable = numberOfActive;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::vacateSlot(std::size_t idx) {
+    // Pre-condition: idx holds a USED key.
     numberOfTombstones++;
-    maxTombstones = std::max(numberOfTombstones, maxTombstones);
+    maxTombstones = std::max<std::int64_t>(numberOfTombstones, maxTombstones);
     hashTableMask.at(idx) = DELETED;
+    hashTable.release(idx);
     numberOfActive--;
     numDeletes++;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::recordCompactionPause(std::int64_t pauseNs) {
+    numCompactionPauses++;
+    maxCompactionPauseNs = std::max<std::int64_t>(maxCompactionPauseNs, pauseNs);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+std::int64_t BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::pauseClockNs() {
+    // A NoStats table doesn't time its pauses, so it doesn't read the clock.
+    if constexpr (StatsPolicy::enabled)
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    else
+        return 0;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::startCompaction() {
+    // The spare table may still have a few slots left to scrub from the
+    // previous round.
+    const std::int64_t t0 = pauseClockNs();
+    for (; compactionCursor < sourceTableMask.size(); compactionCursor++)
+        sourceTableMask.at(compactionCursor) = AVAILABLE;
+
+    hashTable.swap(sourceTable);
+    hashTableMask.swap(sourceTableMask);
+    slotHash.swap(sourceSlotHash);
+    sourceRange = liveRange();
+    numberOfTombstones = 0;   // the tombstones stay behind in the source
+
+    compacting = true;
+    compactionCursor = 0;
+
+    recordCompactionPause(pauseClockNs() - t0);
+}
 
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::compactionStep() {
+    // One bounded unit of incremental compaction. While compacting, it moves
+    // the next compactionSlotsPerStep source slots into the live table.
+    // Afterwards it scrubs the drained table at the same pace so that it is
+    // all AVAILABLE by the time the next compaction swaps it back in. A
+    // resize drains the same way, but into a table of another size.
+    const std::size_t sourceSize = sourceTableMask.size();
+    if (compactionCursor == sourceSize)
+        return;
+
+    const std::int64_t t0 = pauseClockNs();
+    const std::size_t end = std::min(sourceSize, compactionCursor + compactionSlotsPerStep);
+
+    if (compacting) {
+        for (; compactionCursor < end; compactionCursor++) {
+            if (sourceTableMask.at(compactionCursor) != USED)
+                continue;
+
+            // The key is not in the live table, so any free slot on its
+            // probe sequence will do; the stored code says where that is.
+            const std::uint64_t hash = sourceSlotHash.at(compactionCursor);
+            if (probe() == ROBIN_HOOD) {
+                hashTable.moveFrom(hashTable.scratch(), sourceTable, compactionCursor);
+                robinHoodShiftIn(homeSlot(hash), 0, hash);
+            } else {
+                const std::size_t idx = firstFreeSlot(hash);
+                hashTable.moveFrom(idx, sourceTable, compactionCursor);
+                slotHash.at(idx) = hash;
+                if (hashTableMask.at(idx) == DELETED)
+                    numberOfTombstones--;
+                hashTableMask.at(idx) = USED;
+            }
+            // Lookups may still walk through this slot of the source.
+            sourceTableMask.at(compactionCursor) = DELETED;
+        }
+
+        if (compactionCursor == sourceSize) {
+            compacting = false;
+            if (resizing)
+                finishResize();
+            else
+                compactionCursor = 0;   // now scrub the drained table
+        }
+    } else {
+        for (; compactionCursor < end; compactionCursor++)
+            sourceTableMask.at(compactionCursor) = AVAILABLE;
+    }
+
+    recordCompactionPause(pauseClockNs() - t0);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+std::size_t BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::findInCompactionSource(std::string_view v, std::uint64_t hash) {
+    // Returns the source slot that holds v, or sourceTable.size(). A
+    // ROBIN_HOOD source is searched as the linear-probing table it also is.
+    const ProbeResult probe = probeFor(v, hash, sourceRange, sourceTable, sourceTableMask, sourceSlotHash);
+    return probe.found ? probe.idx : sourceTable.size();
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+bool BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::removeFromCompactionSource(std::string_view v, std::uint64_t hash) {
+    // Not moved yet. A tombstone in the source keeps its chains intact
+    // and is simply skipped by the drain.
+    const std::size_t srcIdx = findInCompactionSource(v, hash);
+    if (srcIdx == sourceTable.size())
+        return false;
+    sourceTableMask.at(srcIdx) = DELETED;
+    sourceTable.release(srcIdx);
+    numberOfActive--;
+    numDeletes++;
     return true;
 }
 
-void HashTableDictionary::compactTable() {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::drainCompactionSource() {
+    while (compacting)
+        compactionStep();
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::maybeResize() {
+    // A resize waits for a drain under way to finish; every insert and
+    // remove runs compactionStep() first, so it starts on the operation
+    // that finishes the drain.
+    if (growLoadFactor == 0.0 || compacting)
+        return;
+    const double loadFactor = static_cast<double>(numberOfActive) / static_cast<double>(TABLE_SIZE);
+    if (loadFactor > growLoadFactor)
+        startResize(nextPrime(2 * TABLE_SIZE));
+    else if (loadFactor < shrinkLoadFactor && TABLE_SIZE > initialTableSize)
+        startResize(std::max(initialTableSize, nextPrime(TABLE_SIZE / 2)));
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::startResize(std::size_t newTableSize) {
+    // The live table becomes the source of a drain into a fresh table of
+    // the new size. Only allocating the fresh table is proportional to the
+    // table size; the keys move a few slots per insert/remove.
+    // Pre-condition: no drain is under way (there is one source).
+    assert(!compacting);
+    const std::int64_t t0 = pauseClockNs();
+
+    hashTable.swap(sourceTable);
+    hashTableMask.swap(sourceTableMask);
+    slotHash.swap(sourceSlotHash);
+    sourceRange = liveRange();
+
+    setTableSize(newTableSize);
+    hashTable = KeyStore(TABLE_SIZE, keyStorage == ARENA);
+    hashTableMask.assign(TABLE_SIZE, AVAILABLE);
+    slotHash.assign(TABLE_SIZE, 0);
+    if (probe() == ROBIN_HOOD)
+        probeDistance.assign(TABLE_SIZE, 0);
+    numberOfTombstones = 0;   // the tombstones stay behind in the source
+
+    compacting = true;
+    resizing = true;
+    compactionCursor = 0;
+    numResizes++;
+
+    recordCompactionPause(pauseClockNs() - t0);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::growFullTable() {
+    // Every slot holds a key, which only happens to a table without
+    // setAutoResize(): it grows to about twice its size. This insert needs
+    // a free slot now, so a drain still under way is finished first.
+    drainCompactionSource();
+    if (static_cast<std::size_t>(numberOfActive) < TABLE_SIZE)
+        return;
+    const std::size_t newTableSize = nextPrime(2 * TABLE_SIZE);
+    if (hasher() == WYHASH) {
+        startResize(newTableSize);
+        return;
+    }
+
+    // POLYNOMIAL codes hold the home slot and step for this table size,
+    // so the keys are hashed again, into the new table all at once.
+    const std::int64_t t0 = pauseClockNs();
+    KeyStore oldTable(0, keyStorage == ARENA);
+    std::vector<ELEMENT_STATUS> oldMask;
+    hashTable.swap(oldTable);
+    hashTableMask.swap(oldMask);
+
+    setTableSize(newTableSize);
+    hashTable = KeyStore(TABLE_SIZE, keyStorage == ARENA);
+    hashTableMask.assign(TABLE_SIZE, AVAILABLE);
+    slotHash.assign(TABLE_SIZE, 0);
+    if (probe() == ROBIN_HOOD)
+        probeDistance.assign(TABLE_SIZE, 0);
+    numberOfTombstones = 0;
+
+    for (std::size_t i = 0; i < oldMask.size(); i++) {
+        if (oldMask[i] != USED)
+            continue;
+        const std::uint64_t hash = hashCode(oldTable.at(i));
+        if (probe() == ROBIN_HOOD) {
+            hashTable.moveFrom(hashTable.scratch(), oldTable, i);
+            robinHoodShiftIn(homeSlot(hash), 0, hash);
+        } else {
+            const std::size_t idx = firstFreeSlot(hash);
+            hashTable.moveFrom(idx, oldTable, i);
+            slotHash[idx] = hash;
+            hashTableMask[idx] = USED;
+        }
+    }
+    // An INCREMENTAL spare has to match the new size.
+    if (sourceTableMask.size() != 0) {
+        sourceTable = KeyStore(TABLE_SIZE, keyStorage == ARENA);
+        sourceTableMask.assign(TABLE_SIZE, AVAILABLE);
+        sourceSlotHash.assign(TABLE_SIZE, 0);
+    }
+    sourceRange = liveRange();
+    compactionCursor = sourceTableMask.size();
+    numResizes++;
+
+    recordCompactionPause(pauseClockNs() - t0);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::finishResize() {
+    // The drained table has the old size. INCREMENTAL compaction needs a
+    // spare of the new size; otherwise it is let go.
+    resizing = false;
+    if (shouldCompact && compactionType == INCREMENTAL) {
+        sourceTable = KeyStore(TABLE_SIZE, keyStorage == ARENA);
+        sourceTableMask.assign(TABLE_SIZE, AVAILABLE);
+        sourceSlotHash.assign(TABLE_SIZE, 0);
+    } else {
+        sourceTable = KeyStore();
+        sourceTableMask.clear();
+        sourceTableMask.shrink_to_fit();
+        sourceSlotHash.clear();
+        sourceSlotHash.shrink_to_fit();
+    }
+    sourceRange = liveRange();
+    compactionCursor = sourceTableMask.size();
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::compactTable() {
 
     if (hashTable.size() == 0)
         return;
 
-    std::vector<std::string> newTable(hashTable.size());
+    KeyStore newTable(TABLE_SIZE, keyStorage == ARENA);
     std::vector<ELEMENT_STATUS> newMask(hashTableMask.size(), AVAILABLE);
+    std::vector<std::uint64_t> newHashes(slotHash.size(), 0);
 /*
     std::cout << "Before compacting the table:\n";
     std::cout << "\tNumber of active cells: " << numberOfActive << std::endl;
@@ -129,19 +647,23 @@ void HashTableDictionary::compactTable() {
             beforeCompaction.push_back('1');
         else beforeCompaction.push_back('0');
 
-    auto curNumProbes = totalProbes;
-    auto curNumInserts = numInserts;
     hashTable.swap(newTable);
     hashTableMask.swap(newMask);
-    numberOfActive = 0;
+    slotHash.swap(newHashes);
     numberOfTombstones = 0;
 
+    // The keys are distinct and the fresh table has no tombstones, so each
+    // key goes to the first AVAILABLE slot on the probe sequence its stored
+    // code gives. No string is hashed or compared. In ARENA mode only the
+    // live keys are copied into the fresh arena.
     for (std::size_t i = 0; i < newTable.size(); i++) {
-        if (newMask.at(i) == USED)
-            insert(newTable.at(i));
+        if (newMask.at(i) != USED)
+            continue;
+        const std::size_t idx = firstFreeSlot(newHashes.at(i));
+        hashTable.moveFrom(idx, newTable, i);
+        slotHash.at(idx) = newHashes.at(i);
+        hashTableMask.at(idx) = USED;
     }
-    numInserts = curNumInserts;
-    totalProbes = curNumProbes;
 
     for (std::size_t i = 0; i < hashTableMask.size(); i++)
         if (hashTableMask[i] == USED || hashTableMask[i] == DELETED)
@@ -156,9 +678,69 @@ void HashTableDictionary::compactTable() {
 */
 }
 
-void HashTableDictionary::printActiveDeleteMap() {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::compactInPlace() {
+    // Clears every tombstone and re-places every live key without a second
+    // table. Slots that are USED after pass 1 are final, and a key always
+    // goes to the first non-final slot on its probe sequence. So a slot a
+    // key skipped over is final and never becomes AVAILABLE again, which
+    // keeps each probe sequence unbroken.
+
+    if (hashTable.size() == 0)
+        return;
+
+    beforeCompaction.clear();
+    afterCompaction.clear();
+    for (std::size_t i = 0; i < hashTableMask.size(); i++)
+        if (hashTableMask[i] == USED || hashTableMask[i] == DELETED)
+            beforeCompaction.push_back('1');
+        else beforeCompaction.push_back('0');
+
+    // Pass 1: tombstones become free slots; live keys wait to be re-placed.
+    for (std::size_t i = 0; i < TABLE_SIZE; i++) {
+        if (hashTableMask.at(i) == DELETED)
+            hashTableMask.at(i) = AVAILABLE;
+        else if (hashTableMask.at(i) == USED)
+            hashTableMask.at(i) = PENDING;
+    }
+    numberOfTombstones = 0;
+
+    // Pass 2: place the key in slot i. If its slot is taken by another
+    // pending key, swap the two and go on with the key that came back to i.
+    // Every swap makes one more slot final, so the loop ends.
+    for (std::size_t i = 0; i < TABLE_SIZE; i++) {
+        while (hashTableMask.at(i) == PENDING) {
+            const std::size_t idx = firstFreeSlot(slotHash.at(i));
+
+            if (idx == i) {
+                hashTableMask.at(i) = USED;
+            } else if (hashTableMask.at(idx) == AVAILABLE) {
+                hashTable.moveFrom(idx, hashTable, i);
+                slotHash.at(idx) = slotHash.at(i);
+                hashTableMask.at(idx) = USED;
+                hashTableMask.at(i) = AVAILABLE;
+            } else {
+                hashTable.swapSlots(idx, i);
+                std::swap(slotHash.at(idx), slotHash.at(i));
+                hashTableMask.at(idx) = USED;
+            }
+        }
+    }
+
+    // The removed keys' arena bytes go too, into the spare arena, so this
+    // allocates nothing once the spare has grown to size.
+    hashTable.repack();
+
+    for (std::size_t i = 0; i < hashTableMask.size(); i++)
+        if (hashTableMask[i] == USED || hashTableMask[i] == DELETED)
+            afterCompaction.push_back('1');
+        else afterCompaction.push_back('0');
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::printActiveDeleteMap() {
     std::cout << (shouldCompact ? "compaction_on " : "compaction_off ");
-    std::cout << (probeType == SINGLE ? "single_probing " : "double_probing ");
+    std::cout << probeTypeName() << "_probing ";
     std::cout << TABLE_SIZE << std::endl;
 
     for (std::size_t i = 0; i < hashTableMask.size(); i++) {
@@ -173,10 +755,11 @@ void HashTableDictionary::printActiveDeleteMap() {
 
 }
 
-void HashTableDictionary::printBeforeAndAfterCompactionMaps() {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::printBeforeAndAfterCompactionMaps() {
 /*
     std::cout << (shouldCompact ? "compaction_on " : "compaction_off ");
-    std::cout << (probeType == SINGLE ? "single_probing " : "double_probing ");
+    std::cout << (probe() == SINGLE ? "single_probing " : "double_probing ");
     std::cout << TABLE_SIZE << std::endl;
 */
     for (std::size_t i = 0; i < beforeCompaction.size(); i++) {
@@ -195,42 +778,275 @@ void HashTableDictionary::printBeforeAndAfterCompactionMaps() {
 
 }
 
-std::size_t HashTableDictionary::memberHelper(const std::string& v) {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+auto BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::memberHelper(std::string_view v, PROBE_OP op) -> ProbeResult {
+    beginOp(op);
+    return probeFor(v, hashCode(v), liveRange(), hashTable, hashTableMask, slotHash);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+auto BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::probeFor(std::string_view v, std::uint64_t hash,
+    const SlotRange& range, const KeyStore& keys, const std::vector<ELEMENT_STATUS>& mask,
+    const std::vector<std::uint64_t>& hashes) -> ProbeResult {
 
-    std::size_t idx = primaryHashFunction( v );
-    std::size_t step = secondaryHashFunction( v );
+    std::size_t idx = homeSlot( hash, range );
+    const std::size_t step = probeStep( hash, range );
     std::int64_t numProbesForThisItem = 1;  // Accounting for the fact that the while loop's condition tests the table.
-    std::size_t firstDeleteIdx = hashTable.size();
-
-    while( numProbesForThisItem < TABLE_SIZE && hashTableMask.at(idx) != AVAILABLE &&
-            ( hashTableMask.at(idx) == DELETED || hashTable.at(idx) != v ) ) {
-        if( hashTableMask.at(idx) == DELETED && firstDeleteIdx == hashTable.size() ) {
-            firstDeleteIdx = idx;
+    std::size_t firstDeleteIdx = keys.size();
+    bool found = false;
+
+    while( mask.at(idx) != AVAILABLE ) {
+        if( mask.at(idx) == DELETED ) {
+            if( firstDeleteIdx == keys.size() )
+                firstDeleteIdx = idx;
+        } else if( hashes.at(idx) != hash ) {
+            numStringComparesAvoided++;     // can't be v; no need to look at the string
+        } else if( keys.equals(idx, v) ) {
+            found = true;
+            break;
         }
-        idx = (idx + step) % TABLE_SIZE;
+        if (numProbesForThisItem == static_cast<std::int64_t>(range.size))
+            break;
+        idx = advanceSlot(idx, step, range);
         numProbesForThisItem++;
     }
     // std::cout << std::setw(6) << numComparisons << " comps\n";
-    totalProbes += numProbesForThisItem;
-    if (numProbesForThisItem == TABLE_SIZE) {
+    recordProbes(numProbesForThisItem);
+    if (numProbesForThisItem == static_cast<std::int64_t>(range.size)) {
         numFullScans++;
     }
-    return hashTableMask.at(idx) == USED && hashTable.at(idx) == v ? idx : (firstDeleteIdx != hashTable.size() ? firstDeleteIdx : idx);
+    if (!found && firstDeleteIdx != keys.size())
+        idx = firstDeleteIdx;
+    return {idx, found, hash};
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+std::size_t BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::firstFreeSlot(std::uint64_t hash) const {
+    // The first slot on the probe sequence that does not hold a key. Only
+    // for keys known not to be in the table, so nothing is compared.
+    std::size_t idx = homeSlot( hash );
+    const std::size_t step = probeStep( hash );
+    while (hashTableMask.at(idx) == USED)
+        idx = advanceSlot(idx, step);
+    return idx;
 }
 
-bool HashTableDictionary::member(const std::string& v )  {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+bool BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::member(std::string_view v )  {
     // Returns true if v a member. Otherwise, it returns false
+    return findKey(v, hashCode(v));
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+bool BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::findKey(std::string_view v, std::uint64_t hash) {
+    beginOp(PROBE_LOOKUP);
+    if (probe() == ROBIN_HOOD) {
+        numLookups++;
+        if (robinHoodFind(v, hash) != TABLE_SIZE)
+            return true;
+        return compacting && findInCompactionSource(v, hash) != sourceTable.size();
+    }
 
-    auto idx = memberHelper(v);
+    const ProbeResult probe = probeFor(v, hash, liveRange(), hashTable, hashTableMask, slotHash);
     numLookups++;
-    return  hashTableMask.at(idx) == USED && hashTable.at(idx) == v;
+    if (probe.found)
+        return true;
+    return compacting && findInCompactionSource(v, probe.hash) != sourceTable.size();
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::prefetchHome(std::uint64_t hash) const {
+    // The cache lines a probe reads first. A hint: nothing changes.
+    const std::size_t idx = homeSlot(hash);
+    __builtin_prefetch(hashTableMask.data() + idx);
+    __builtin_prefetch(slotHash.data() + idx);
+    hashTable.prefetch(idx);
+    if (probe() == ROBIN_HOOD)
+        __builtin_prefetch(probeDistance.data() + idx);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+template<class OpAt>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::runBatch(OpAt opAt,
+    const std::string_view* keys, std::size_t n, bool* results) {
+    // A WYHASH code does not depend on the table size, so codes taken
+    // before the group runs stay good even if an operation in it resizes
+    // or compacts the table; only the prefetches are wasted then. A
+    // POLYNOMIAL code does, so the rest of the group is hashed again if a
+    // full table grows.
+    std::uint64_t hashes[BATCH_GROUP];
+    for (std::size_t start = 0; start < n; start += BATCH_GROUP) {
+        const std::size_t end = std::min(n, start + BATCH_GROUP);
+        for (std::size_t i = start; i < end; i++) {
+            hashes[i - start] = hashCode(keys[i]);
+            prefetchHome(hashes[i - start]);
+        }
+        const std::size_t hashedFor = TABLE_SIZE;
+        for (std::size_t i = start; i < end; i++) {
+            if (hasher() == POLYNOMIAL && TABLE_SIZE != hashedFor)
+                hashes[i - start] = hashCode(keys[i]);
+            bool result = false;
+            switch (opAt(i)) {
+                case BATCH_INSERT: result = insertKey(keys[i], hashes[i - start]); break;
+                case BATCH_MEMBER: result = findKey(keys[i], hashes[i - start]); break;
+                case BATCH_REMOVE: result = removeKey(keys[i], hashes[i - start]); break;
+            }
+            if (results != nullptr)
+                results[i] = result;
+        }
+    }
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::insertBatch(const std::string_view* keys,
+    std::size_t n, bool* results) {
+    runBatch([](std::size_t) { return BATCH_INSERT; }, keys, n, results);
 }
 
-bool HashTableDictionary::empty() const {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::memberBatch(const std::string_view* keys,
+    std::size_t n, bool* results) {
+    runBatch([](std::size_t) { return BATCH_MEMBER; }, keys, n, results);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::removeBatch(const std::string_view* keys,
+    std::size_t n, bool* results) {
+    runBatch([](std::size_t) { return BATCH_REMOVE; }, keys, n, results);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::applyBatch(const BATCH_OP* ops,
+    const std::string_view* keys, std::size_t n, bool* results) {
+    runBatch([ops](std::size_t i) { return ops[i]; }, keys, n, results);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+std::size_t BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::robinHoodFind(std::string_view v, std::uint64_t hash) {
+    // Returns the slot that holds v, or TABLE_SIZE. Had v been inserted, it
+    // would have taken the slot of any key that is closer to its home than
+    // v is to its own, so reaching such a key ends the search.
+    std::size_t idx = homeSlot( hash );
+    std::size_t dist = 0;
+    std::int64_t numProbesForThisItem = 1;
+
+    while (hashTableMask.at(idx) == USED && probeDistance.at(idx) >= dist && dist < TABLE_SIZE) {
+        if (probeDistance.at(idx) == dist) {
+            if (slotHash.at(idx) != hash) {
+                numStringComparesAvoided++;
+            } else if (hashTable.equals(idx, v)) {
+                recordProbes(numProbesForThisItem);
+                return idx;
+            }
+        }
+        idx = advanceSlot(idx, 1);
+        dist++;
+        numProbesForThisItem++;
+    }
+    recordProbes(numProbesForThisItem);
+    if (dist == TABLE_SIZE)
+        numFullScans++;
+    return TABLE_SIZE;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+template<class Key>
+bool BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::robinHoodInsert(Key&& v, std::uint64_t hash) {
+    // One pass: look for v and, at the same time, for the first slot that
+    // is free or whose key is closer to home than v would be.
+    std::size_t idx = homeSlot( hash );
+    std::size_t dist = 0;
+    std::int64_t numProbesForThisItem = 1;
+
+    while (hashTableMask.at(idx) == USED && probeDistance.at(idx) >= dist) {
+        if (probeDistance.at(idx) == dist) {
+            if (slotHash.at(idx) != hash) {
+                numStringComparesAvoided++;
+            } else if (hashTable.equals(idx, v)) {
+                recordProbes(numProbesForThisItem);
+                return false;
+            }
+        }
+        idx = advanceSlot(idx, 1);
+        dist++;
+        numProbesForThisItem++;
+    }
+    recordProbes(numProbesForThisItem);
+    if (compacting && findInCompactionSource(v, hash) != sourceTable.size())
+        return false;
+
+    // v waits in the scratch slot while it and the keys it displaces are
+    // shifted in.
+    hashTable.assign(hashTable.scratch(), std::forward<Key>(v));
+    robinHoodShiftIn(idx, dist, hash);
+
+    numberOfActive++;
+    numInserts++;
+    if (maxValuesInTable < numberOfActive)
+        maxValuesInTable = numberOfActive;
+
+    return true;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::robinHoodShiftIn(std::size_t idx, std::size_t dist, std::uint64_t hash) {
+    // The key in the scratch slot, with code hash, is dist slots from home
+    // at idx. It takes the slot of the first key that is closer to home
+    // than it is; that key is carried on and does the same, until one
+    // reaches a free slot. A key known not to be in the table can start at
+    // its home slot with dist 0.
+    const std::size_t carried = hashTable.scratch();
+    std::uint64_t carriedHash = hash;
+    auto carriedDist = static_cast<std::uint32_t>(dist);
+    while (hashTableMask.at(idx) == USED) {
+        if (probeDistance.at(idx) < carriedDist) {
+            // The resident key is displaced and carried on.
+            hashTable.swapSlots(idx, carried);
+            std::swap(slotHash.at(idx), carriedHash);
+            std::swap(probeDistance.at(idx), carriedDist);
+            totalShifts++;
+        }
+        idx = advanceSlot(idx, 1);
+        carriedDist++;
+    }
+    hashTable.swapSlots(idx, carried);
+    slotHash.at(idx) = carriedHash;
+    probeDistance.at(idx) = carriedDist;
+    hashTableMask.at(idx) = USED;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+bool BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::robinHoodRemove(std::string_view v, std::uint64_t hash) {
+    std::size_t idx = robinHoodFind(v, hash);
+    if (idx == TABLE_SIZE)
+        return compacting && removeFromCompactionSource(v, hash);
+
+    // Backward shift: pull the rest of the run one slot closer to home
+    // until a free slot or a key that already sits at home.
+    std::size_t next = advanceSlot(idx, 1);
+    while (hashTableMask.at(next) == USED && probeDistance.at(next) > 0) {
+        hashTable.swapSlots(idx, next);
+        slotHash.at(idx) = slotHash.at(next);
+        probeDistance.at(idx) = probeDistance.at(next) - 1;
+        idx = next;
+        next = advanceSlot(next, 1);
+        totalShifts++;
+    }
+    hashTable.release(idx);
+    hashTableMask.at(idx) = AVAILABLE;
+    probeDistance.at(idx) = 0;
+
+    numberOfActive--;
+    numDeletes++;
+    return true;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+bool BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::empty() const {
     return numberOfActive == 0;
 }
 
-std::string HashTableDictionary::csvStatsHeader() {
+std::string HashTableCommon::csvStatsHeader() {
     return std::string("table_size") +
            std::string(",active") +
                std::string(",available") +
@@ -241,21 +1057,170 @@ std::string HashTableDictionary::csvStatsHeader() {
            std::string(",available_pct") + std::string(",load_factor_pct") +
            std::string(",eff_load_factor_pct") +
            std::string(",tombstones_pct") + std::string(",average_probes") +
-           std::string(",probe_type") + std::string(",compaction_state");
+           std::string(",probe_type") + std::string(",compaction_state") +
+           std::string(",compaction_type") + std::string(",compaction_pauses") + std::string(",max_pause_us") +
+           std::string(",shifted_keys") + std::string(",delete_type") +
+           std::string(",compares_avoided") + std::string(",hash_type") +
+           std::string(",key_storage") + std::string(",key_bytes_per_key") +
+           std::string(",resizes") +
+           std::string(",insert_probes_p50") + std::string(",insert_probes_p99") + std::string(",insert_probes_max") +
+           std::string(",lookup_probes_p50") + std::string(",lookup_probes_p99") + std::string(",lookup_probes_max") +
+           std::string(",remove_probes_p50") + std::string(",remove_probes_p99") + std::string(",remove_probes_max") +
+           std::string(",clusters") + std::string(",cluster_mean") +
+           std::string(",cluster_p99") + std::string(",cluster_max");
+}
+
+std::string HashTableCommon::probeStatsCsv(const LengthHistogram (&probeLengths)[NUM_PROBE_OPS],
+    const ClusterStats& clusters) {
+    std::string csv;
+    for (const auto& lengths : probeLengths) {
+        if (lengths.count() == 0) {
+            csv += ",,,";
+            continue;
+        }
+        csv += "," + std::to_string(lengths.percentile(0.5)) +
+               "," + std::to_string(lengths.percentile(0.99)) +
+               "," + std::to_string(lengths.max());
+    }
+    const LengthHistogram& runs = clusters.runLengths;
+    if (runs.count() == 0)
+        return csv + ",0,,,";
+    return csv + "," + std::to_string(runs.count()) +
+           "," + std::to_string(runs.mean()) +
+           "," + std::to_string(runs.percentile(0.99)) +
+           "," + std::to_string(runs.max());
+}
+
+// ================================================================
+// LengthHistogram
+// ================================================================
+void HashTableCommon::LengthHistogram::merge(const LengthHistogram& other) {
+    for (std::size_t b = 0; b < NUM_BUCKETS; b++)
+        counts[b] += other.counts[b];
+    numValues += other.numValues;
+    sum += other.sum;
+    maxLength = std::max(maxLength, other.maxLength);
+}
+
+void HashTableCommon::LengthHistogram::clear() {
+    *this = LengthHistogram();
 }
 
-std::string HashTableDictionary::csvStats() {
+std::uint64_t HashTableCommon::LengthHistogram::bucketUpperBound(std::size_t b) {
+    return b < 8 ? b + 1 : std::uint64_t{1} << (b - 4);
+}
+
+std::uint64_t HashTableCommon::LengthHistogram::percentile(double q) const {
+    if (numValues == 0)
+        return 0;
+    const auto rank = std::max<std::uint64_t>(1,
+        static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(numValues))));
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < NUM_BUCKETS; b++) {
+        seen += counts[b];
+        if (seen >= rank)
+            return std::min(bucketUpperBound(b), maxLength);
+    }
+    return maxLength;
+}
+
+// ================================================================
+// occupiedRuns: find where each run of set bits starts and ends with
+// count-trailing-zeros, 64 slots a step. A run that starts at slot 0
+// is held back: a run that ends at the last slot continues it.
+// ================================================================
+HashTableCommon::ClusterStats HashTableCommon::occupiedRuns(const std::vector<std::uint64_t>& bits,
+    std::size_t numSlots) {
+    // The first slot at or after from whose bit is set (or clear), or numSlots.
+    auto nextWith = [&](std::size_t from, bool set) {
+        std::size_t w = from / 64;
+        if (w >= bits.size())
+            return numSlots;
+        std::uint64_t word = (set ? bits[w] : ~bits[w]) & (~std::uint64_t{0} << (from % 64));
+        while (word == 0) {
+            if (++w == bits.size())
+                return numSlots;
+            word = set ? bits[w] : ~bits[w];
+        }
+        return std::min(numSlots, w * 64 + static_cast<std::size_t>(__builtin_ctzll(word)));
+    };
+
+    ClusterStats clusters;
+    std::size_t headRun = 0;
+    std::size_t pos = 0;
+    while (pos < numSlots) {
+        const std::size_t start = nextWith(pos, true);
+        if (start == numSlots)
+            break;
+        const std::size_t end = nextWith(start, false);
+        const std::size_t length = end - start;
+        clusters.occupiedSlots += length;
+        if (start == 0 && end < numSlots) {
+            headRun = length;
+        } else if (end == numSlots && headRun != 0) {
+            clusters.runLengths.record(length + headRun);
+            headRun = 0;
+        } else {
+            clusters.runLengths.record(length);
+        }
+        pos = end;
+    }
+    if (headRun != 0)
+        clusters.runLengths.record(headRun);
+    return clusters;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+HashTableCommon::ClusterStats BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::clusterStats() const {
+    std::vector<std::uint64_t> bits((TABLE_SIZE + 63) / 64, 0);
+    for (std::size_t i = 0; i < TABLE_SIZE; i++)
+        bits[i / 64] |= static_cast<std::uint64_t>(hashTableMask[i] != AVAILABLE) << (i % 64);
+    return occupiedRuns(bits, TABLE_SIZE);
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+HashTableCommon::TableStats BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::stats() const {
+    TableStats s;
+    s.tableSize = TABLE_SIZE;
+    s.active = numberOfActive;
+    s.tombstones = numberOfTombstones;
+    s.inserts = numInserts;
+    s.deletes = numDeletes;
+    s.lookups = numLookups;
+    s.totalProbes = totalProbes;
+    s.fullScans = numFullScans;
+    s.compactions = numCompactions;
+    s.resizes = numResizes;
+    flushProbeSample();
+    for (int op = 0; op < NUM_PROBE_OPS; op++)
+        s.probeLengths[op] = probeLengthsByOp[op];
+    s.clusters = clusterStats();
+    return s;
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+std::string BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::csvStats() {
+    // Under NoStats the counters read 0 whatever the table did, so their
+    // columns are left empty rather than look like measurements.
+    auto counter = [](std::int64_t value) {
+        return StatsPolicy::enabled ? std::to_string(value) : std::string();
+    };
+    const std::int64_t numOps = numInserts + numDeletes + numLookups;
+    flushProbeSample();
+    const std::string averageProbes = numOps == 0 ? std::string() :
+        std::to_string(static_cast<double>(totalProbes) / static_cast<double>(numOps));
+
     return std::to_string(TABLE_SIZE) + "," + // table size
            std::to_string(numberOfActive) + "," + // active
            std::to_string(TABLE_SIZE - numberOfTombstones - numberOfActive) + "," + // available
            std::to_string(numberOfTombstones) + "," + // tombstones
-           std::to_string(totalProbes) + "," + // totalProbes
-           std::to_string(numInserts) + "," + // inserts
-           std::to_string(numDeletes) + "," + // deletes
-           std::to_string(numLookups) + "," + // lookups
-           std::to_string(numFullScans) + "," + // full scans
-           std::to_string(numCompactions) + "," + // compactions
-           std::to_string(maxValuesInTable) + "," + // max_in_table
+           counter(totalProbes) + "," + // totalProbes
+           counter(numInserts) + "," + // inserts
+           counter(numDeletes) + "," + // deletes
+           counter(numLookups) + "," + // lookups
+           counter(numFullScans) + "," + // full scans
+           counter(numCompactions) + "," + // compactions
+           counter(maxValuesInTable) + "," + // max_in_table
            std::to_string(
                static_cast<int>(static_cast<double>(TABLE_SIZE - numberOfTombstones - numberOfActive) /
                    static_cast<double>(TABLE_SIZE) * 100)) + "," + // ratio available
@@ -267,27 +1232,52 @@ std::string HashTableDictionary::csvStats() {
            std::to_string(
                static_cast<int>(static_cast<double>(numberOfTombstones) / static_cast<double>(TABLE_SIZE) * 100)) + ","
            + // ratio tombstones
-           std::to_string(static_cast<double>(totalProbes) / static_cast<double>(numInserts + numDeletes + numLookups)) +
-           ((probeType == SINGLE) ? ",single," : ",double,") +
-           (shouldCompact ? "compaction_on" : "compaction_off");
+           averageProbes + "," + probeTypeName() + "," +
+           (shouldCompact ? "compaction_on" : "compaction_off") +
+           ((compactionType == INCREMENTAL) ? ",incremental," :
+               (compactionType == IN_PLACE) ? ",in_place," : ",rebuild,") +
+           counter(numCompactionPauses) + "," + // compaction pauses
+           (StatsPolicy::enabled ? std::to_string(static_cast<double>(maxCompactionPauseNs) / 1e3) : std::string()) + "," + // longest pause
+           counter(totalShifts) + // keys moved by robin hood or backward shift
+           (deleteType == BACKWARD_SHIFT ? ",backward_shift," : ",tombstone,") +
+           counter(numStringComparesAvoided) + "," + // string compares skipped on a hash mismatch
+           hashTypeName() +
+           (keyStorage == ARENA ? ",arena," : ",strings,") +
+           std::to_string(keyBytesPerKey()) + "," +
+           counter(numResizes) +
+           probeStatsCsv(probeLengthsByOp, clusterStats());
 }
 
-void HashTableDictionary::printStats() const {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::printStats() const {
 
     const int width = 8;
     std::cout << std::setw(width) << TABLE_SIZE << " table size: " << std::endl;
     std::cout << std::setw(width) << numberOfTombstones << " cells marked as deleted."  << std::endl;
     std::cout << std::setw(width) << numberOfActive << " active cells."  << std::endl;
     std::cout << std::setw(width) << TABLE_SIZE - numberOfTombstones - numberOfActive << " available elements.\n";
-    std::cout << std::setw(width) << maxValuesInTable << " maximum number of values in the table ever." << std::endl;
-    std::cout << std::setw(width) << totalProbes << " total probes." << std::endl;
-
+    std::cout << std::setw(width) << keyBytesPerKey() << " bytes of key storage per live key ("
+              << (keyStorage == ARENA ? "arena" : "strings") << ")." << std::endl;
     std::cout << std::endl;
-    std::cout << std::setw(width) << numInserts << " inserts."  << std::endl;
-    std::cout << std::setw(width) << numDeletes << " deletes."  << std::endl;
-    std::cout << std::setw(width) << numLookups << " lookups."  << std::endl;
-    std::cout << std::setw(width) << numFullScans << " full scans."  << std::endl;
-    std::cout << std::setw(width) << numCompactions << " compactions."  << std::endl;
+
+    // Under NoStats the counters all read 0, whatever the table did.
+    if constexpr (StatsPolicy::enabled) {
+        std::cout << std::setw(width) << maxValuesInTable << " maximum number of values in the table ever." << std::endl;
+        std::cout << std::setw(width) << totalProbes << " total probes." << std::endl;
+        std::cout << std::setw(width) << numStringComparesAvoided << " string compares avoided by stored hash codes." << std::endl;
+        std::cout << std::setw(width) << numInserts << " inserts."  << std::endl;
+        std::cout << std::setw(width) << numDeletes << " deletes."  << std::endl;
+        std::cout << std::setw(width) << numLookups << " lookups."  << std::endl;
+        std::cout << std::setw(width) << numFullScans << " full scans."  << std::endl;
+        std::cout << std::setw(width) << numCompactions << " compactions."  << std::endl;
+        std::cout << std::setw(width) << numResizes << " resizes."  << std::endl;
+        std::cout << std::setw(width) << numCompactionPauses << " compaction pauses ("
+                  << (compactionType == INCREMENTAL ? "incremental" : compactionType == IN_PLACE ? "in place" : "rebuild")
+                  << "), the longest "
+                  << static_cast<double>(maxCompactionPauseNs) / 1e3 << " us." << std::endl;
+    } else {
+        std::cout << "No operation counts kept (statistics off)." << std::endl;
+    }
     std::cout << std::endl;
     std::cout << std::setw(width) << static_cast<int>(static_cast<double>(TABLE_SIZE - numberOfTombstones - numberOfActive) / static_cast<double>(TABLE_SIZE) * 100) <<
         "% ratio of available elements." << std::endl;
@@ -304,38 +1294,80 @@ void HashTableDictionary::printStats() const {
 
     std::cout << std::endl;
 
-    std::cout << static_cast<double>(totalProbes) / static_cast<double>(numInserts + numDeletes + numLookups) <<
-     " average number of probes";
-
-    if (probeType == SINGLE)
-        std::cout << " (single probing, " << (shouldCompact ? "compaction on)." : "compaction off).") << std::endl;
+    const std::int64_t numOps = numInserts + numDeletes + numLookups;
+    if (numOps != 0)
+        std::cout << static_cast<double>(totalProbes) / static_cast<double>(numOps) <<
+         " average number of probes";
     else
-        std::cout << " (double probing, " << (shouldCompact ? "compaction on)." : "compaction off).") << std::endl;
+        std::cout << "No probes counted";
+
+    std::cout << " (" << probeTypeName() << " probing, " << hashTypeName() << " hash, " << (shouldCompact ? "compaction on)." : "compaction off).") << std::endl;
+    if (StatsPolicy::enabled && (probe() == ROBIN_HOOD || deleteType == BACKWARD_SHIFT))
+        std::cout << std::setw(width) << totalShifts << " keys shifted by inserts and removes." << std::endl;
+
+    flushProbeSample();
+    const char* opNames[NUM_PROBE_OPS] = {"insert", "lookup", "remove"};
+    for (int op = 0; op < NUM_PROBE_OPS; op++) {
+        const LengthHistogram& lengths = probeLengthsByOp[op];
+        if (lengths.count() == 0)
+            continue;
+        std::cout << std::setw(width) << lengths.percentile(0.5) << " median " << opNames[op] << " probe length, "
+                  << lengths.percentile(0.99) << " at the 99th percentile, " << lengths.max() << " the longest." << std::endl;
+    }
+    const ClusterStats clusters = clusterStats();
+    std::cout << std::setw(width) << clusters.runLengths.count() << " runs of occupied slots, "
+              << clusters.runLengths.mean() << " slots on average, " << clusters.runLengths.max() << " the longest." << std::endl;
+}
 
 
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+std::size_t BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::primaryHashFunction(std::string_view v) {
+
+    return polynomialHash(v, 131, TABLE_SIZE);  // base 131; 0..LARGE_TWIN-1
 }
 
 
-std::size_t HashTableDictionary::primaryHashFunction(const std::string& v) {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+std::uint64_t BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::hashCode(std::string_view v) {
+    // POLYNOMIAL packs the home slot and the step - 1 so that homeSlot()
+    // and probeStep() give back exactly what the two functions computed.
+    if (hasher() == POLYNOMIAL)
+        return static_cast<std::uint64_t>(primaryHashFunction(v)) |
+               (static_cast<std::uint64_t>(secondaryHashFunction(v) - 1) << 32);
+    return wyhash64(v);
+}
 
-    std::size_t idx = 0;
-    for (unsigned char c : v) {
-        idx = (idx * 131 + c) % TABLE_SIZE;     // base 131
-    }
-    return idx;                                 // 0..LARGE_TWIN-1
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+double BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::keyBytesPerKey() const {
+    // All the memory the keys take, the spare table's included, over the
+    // number of live keys.
+    const std::size_t bytes = hashTable.bytesUsed() + sourceTable.bytesUsed();
+    return static_cast<double>(bytes) / static_cast<double>(std::max<std::int64_t>(numberOfActive, 1));
 }
 
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+const char* BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::hashTypeName() const {
+    return hashType == POLYNOMIAL ? "polynomial" : "wyhash";
+}
 
-std::size_t HashTableDictionary::secondaryHashFunction(const std::string& v) {
-    if (probeType == SINGLE)
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+const char* BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::probeTypeName() const {
+    switch (probeType) {
+        case SINGLE: return "single";
+        case DOUBLE: return "double";
+        case ROBIN_HOOD: return "robin_hood";
+    }
+    return "unknown";
+}
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+std::size_t BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::secondaryHashFunction(std::string_view v) {
+    if (probe() != DOUBLE)
         return 1;                // linear probing
 
 
-    std::size_t idx = 0;
-    for (unsigned char c : v) {
-        idx = (idx * 257 + c) % (TABLE_SIZE - 1);      // base 257
-    }
-    return 1 + idx;                                    // 1..LARGE_TWIN-1  (gcd(step, LARGE_TWIN)=1)
+    // base 257; 1..LARGE_TWIN-1  (gcd(step, LARGE_TWIN)=1)
+    return 1 + polynomialHash(v, 257, TABLE_SIZE - 1);
 }
 
 void inRed(char c) {
@@ -361,7 +1393,8 @@ void inCyan(char c) {
     std::cout << "\x1b[36m" << c << "\x1b[0m";
 }
 
-void HashTableDictionary::printMask(ELEMENT_STATUS es) {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::printMask(ELEMENT_STATUS es) {
     for(size_t i = 0; i < TABLE_SIZE; i++) {
         if(hashTableMask.at(i) == USED)
             inRed(es == USED ? '-' : ' ');
@@ -379,7 +1412,8 @@ void HashTableDictionary::printMask(ELEMENT_STATUS es) {
     std::cout << std::endl;
 }
 
-void HashTableDictionary::printMask() {
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+void BasicHashTableDictionary<ProbePolicy, HashPolicy, StatsPolicy>::printMask() {
     std::cout << "Elements in use map.\n";
     printMask(USED);
     std::cout << "\nElements deleted map.\n";
@@ -387,3 +1421,8 @@ void HashTableDictionary::printMask() {
     std::cout << "\nElements available map.\n";
     printMask(AVAILABLE);
 }
+
+template class BasicHashTableDictionary<RuntimeProbe, RuntimeHasher, FullStats>;
+template class BasicHashTableDictionary<LinearProbe, WyHasher, NoStats>;
+template class BasicHashTableDictionary<DoubleProbe, WyHasher, NoStats>;
+template class BasicHashTableDictionary<RobinHoodProbe, WyHasher, NoStats>;
@@ -7,23 +7,238 @@
 
 #include<vector>
 #include<string>
+#include<string_view>
 #include <cstdint>
 
-class HashTableDictionary {
+#include "KeyHash.hpp"
+#include "KeyStore.hpp"
 
-    enum ELEMENT_STATUS {AVAILABLE, DELETED, USED};
+class ConcurrentHashTableDictionary;
+
+// What every instantiation of BasicHashTableDictionary shares: the option
+// enums and the helpers that don't depend on the policies.
+class HashTableCommon {
+
+protected:
+    // PENDING only exists during an in-place compaction: a live key that
+    // has not been re-placed yet.
+    enum ELEMENT_STATUS {AVAILABLE, DELETED, USED, PENDING};
+
+public:
+    // ROBIN_HOOD is linear probing that keeps every slot's displacement from
+    // its home slot. An insert takes the slot of any key that is closer to
+    // home than the new key, a lookup miss stops as soon as it sees such a
+    // key, and a remove shifts the rest of the run back one slot instead of
+    // leaving a tombstone.
+    enum PROBE_TYPE {SINGLE, DOUBLE, ROBIN_HOOD};
+
+    // REBUILD rehashes the whole table inside the insert that crosses the
+    // trigger. INCREMENTAL moves the live keys into a fresh table a few
+    // slots per insert/remove; both tables are searched until it finishes.
+    // IN_PLACE is a stop-the-world compaction like REBUILD, but it
+    // re-places the keys inside the existing arrays and allocates nothing.
+    enum COMPACTION_TYPE {REBUILD, INCREMENTAL, IN_PLACE};
+
+    // TOMBSTONE marks a removed slot DELETED. BACKWARD_SHIFT, for SINGLE
+    // probing only, closes the gap right away by moving later keys of the
+    // cluster back, so the table never holds a tombstone.
+    enum DELETE_TYPE {TOMBSTONE, BACKWARD_SHIFT};
+
+    // POLYNOMIAL is the original pair of per-character modulo hashes, one
+    // pass for the home slot and one for the DOUBLE step. WYHASH hashes the
+    // key once into 64 bits (see KeyHash.hpp) and cuts both from that value.
+    enum HASH_TYPE {POLYNOMIAL, WYHASH};
+
+    // STRING_SLOTS keeps a std::string in every slot. ARENA keeps an 8-byte
+    // offset/length per slot into one byte arena (see KeyStore.hpp); the
+    // space of removed keys is reclaimed when the table is compacted.
+    enum KEY_STORAGE {STRING_SLOTS, ARENA};
+
+    // The operations applyBatch() can mix.
+    enum BATCH_OP {BATCH_INSERT, BATCH_MEMBER, BATCH_REMOVE};
+
+    // The kinds of operation whose probe lengths are kept apart.
+    enum PROBE_OP {PROBE_INSERT, PROBE_LOOKUP, PROBE_REMOVE, NUM_PROBE_OPS};
+
+    // A histogram of lengths of 1 or more. Lengths 1 to 8 have a bucket
+    // each; above that each power of two, (8, 16], (16, 32], ..., has one.
+    class LengthHistogram {
+    public:
+        static constexpr std::size_t NUM_BUCKETS = 40;
+
+        void record( std::uint64_t length ) {
+            ++counts[bucketOf(length)];
+            ++numValues;
+            sum += length;
+            if (length > maxLength)
+                maxLength = length;
+        }
+        void merge( const LengthHistogram& other );
+        void clear();
+
+        [[nodiscard]] std::uint64_t count() const { return numValues; }
+        [[nodiscard]] std::uint64_t max() const { return maxLength; }
+        [[nodiscard]] double mean() const {
+            return numValues == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(numValues);
+        }
+        // The top of the bucket that the fraction q of the lengths reaches,
+        // capped at max(): exact up to 8, within a factor of 2 above.
+        [[nodiscard]] std::uint64_t percentile( double q ) const;
+        [[nodiscard]] std::uint64_t bucketCount( std::size_t b ) const { return counts[b]; }
+        [[nodiscard]] static std::uint64_t bucketUpperBound( std::size_t b );
+
+    private:
+        std::uint64_t counts[NUM_BUCKETS] = {};
+        std::uint64_t numValues = 0;
+        std::uint64_t sum = 0;
+        std::uint64_t maxLength = 0;
+
+        static std::size_t bucketOf( std::uint64_t length ) {
+            if (length <= 8)
+                return length == 0 ? 0 : static_cast<std::size_t>(length - 1);
+            const auto b = static_cast<std::size_t>(8 + (64 - __builtin_clzll(length - 1)) - 4);
+            return b < NUM_BUCKETS ? b : NUM_BUCKETS - 1;
+        }
+    };
+
+    // The runs of occupied slots (USED or DELETED: a probe walks through
+    // both) in a table as it stands. A run that wraps past the last slot
+    // is one run.
+    struct ClusterStats {
+        std::size_t occupiedSlots = 0;
+        LengthHistogram runLengths;
+    };
+
+    // printStats() and the counters of csvStats() as numbers. With NoStats
+    // the counters are 0 and the probe lengths empty; the clusters and the
+    // slot counts are always there.
+    struct TableStats {
+        std::size_t tableSize = 0;
+        std::int64_t active = 0;
+        std::int64_t tombstones = 0;
+        std::int64_t inserts = 0;
+        std::int64_t deletes = 0;
+        std::int64_t lookups = 0;
+        std::int64_t totalProbes = 0;
+        std::int64_t fullScans = 0;
+        std::int64_t compactions = 0;
+        std::int64_t resizes = 0;
+        LengthHistogram probeLengths[NUM_PROBE_OPS];
+        ClusterStats clusters;
+    };
+
+    static std::string csvStatsHeader();
+
+    // A prime table size for N keys, about N * 5/4 so the table runs at a
+    // load factor of about 0.8.
+    static std::size_t tableSizeForCapacity( std::size_t N );
+    static std::size_t nextPrime( std::size_t n );
+
+protected:
+    // The runs of set bits in bits[0, numSlots), found a word at a time.
+    static ClusterStats occupiedRuns( const std::vector<std::uint64_t>& bits, std::size_t numSlots );
+    // The probe length and cluster columns that end csvStats(); a
+    // histogram with nothing in it gives empty columns.
+    static std::string probeStatsCsv( const LengthHistogram (&probeLengths)[NUM_PROBE_OPS], const ClusterStats& clusters );
+};
+
+// Probe and hash policies. resolve() maps the option the table was built
+// with to the one it runs with. The Runtime policies keep it; the others
+// return a constant, so every test of the option folds away and the probe
+// loop is compiled for that one probe type or hasher.
+struct RuntimeProbe {
+    static constexpr HashTableCommon::PROBE_TYPE resolve( HashTableCommon::PROBE_TYPE p ) { return p; }
+};
+struct LinearProbe {
+    static constexpr HashTableCommon::PROBE_TYPE resolve( HashTableCommon::PROBE_TYPE ) { return HashTableCommon::SINGLE; }
+};
+struct DoubleProbe {
+    static constexpr HashTableCommon::PROBE_TYPE resolve( HashTableCommon::PROBE_TYPE ) { return HashTableCommon::DOUBLE; }
+};
+struct RobinHoodProbe {
+    static constexpr HashTableCommon::PROBE_TYPE resolve( HashTableCommon::PROBE_TYPE ) { return HashTableCommon::ROBIN_HOOD; }
+};
+
+struct RuntimeHasher {
+    static constexpr HashTableCommon::HASH_TYPE resolve( HashTableCommon::HASH_TYPE h ) { return h; }
+};
+struct PolynomialHasher {
+    static constexpr HashTableCommon::HASH_TYPE resolve( HashTableCommon::HASH_TYPE ) { return HashTableCommon::POLYNOMIAL; }
+};
+struct WyHasher {
+    static constexpr HashTableCommon::HASH_TYPE resolve( HashTableCommon::HASH_TYPE ) { return HashTableCommon::WYHASH; }
+};
+
+// Statistics policies. Every counter that only feeds printStats() and
+// csvStats() has type StatsPolicy::Counter. NoStats makes it a NullCounter:
+// updates compile to nothing and reads give 0. Pauses are not timed either.
+class NullCounter {
+public:
+    constexpr NullCounter( std::int64_t = 0 ) {}
+    NullCounter& operator++() { return *this; }
+    NullCounter operator++( int ) { return *this; }
+    NullCounter& operator+=( std::int64_t ) { return *this; }
+    constexpr operator std::int64_t() const { return 0; }
+};
+
+struct FullStats {
+    using Counter = std::int64_t;
+    static constexpr bool enabled = true;
+};
+struct NoStats {
+    using Counter = NullCounter;
+    static constexpr bool enabled = false;
+};
+
+template<class ProbePolicy, class HashPolicy, class StatsPolicy>
+class BasicHashTableDictionary : public HashTableCommon {
+
+    // Adds its shards' counters up for csvStats().
+    friend class ConcurrentHashTableDictionary;
 
 public:
-    enum PROBE_TYPE {SINGLE, DOUBLE};
+    // tableSize_ is rounded up to a prime (DOUBLE probing needs one).
+    BasicHashTableDictionary( std::size_t tableSize_,
+        PROBE_TYPE probeType, bool doCompact=false, double compactionTriggerRate=0.95,
+        COMPACTION_TYPE compactionType=REBUILD, std::size_t slotsPerCompactionStep=64);
 
-    HashTableDictionary( std::size_t tableSize_,
-        PROBE_TYPE probeType, bool doCompact=false, double compactionTriggerRate=0.95);
+    // Call before the first insert.
+    void setDeleteType( DELETE_TYPE type );
+    void setHashType( HASH_TYPE type );
+    void setKeyStorage( KEY_STORAGE type );
+    // Grow the table to about twice its size when an insert takes the load
+    // factor over growAt, and shrink it to about half, never below the
+    // initial size, when a remove takes it under shrinkAt (0: never). The
+    // new table is allocated at once, but the keys move into it a few
+    // slots per insert/remove, like an INCREMENTAL compaction, and both
+    // tables are searched until they have all moved. A resize that comes
+    // due during a drain starts when the drain finishes. Needs WYHASH: the
+    // stored hash codes have to be valid for any table size. Without
+    // setAutoResize() a table grows only when every slot holds a key.
+    void setAutoResize( double growAt, double shrinkAt=0.0 );
 
 
 
+    // Lookups and removes take any contiguous run of characters; a key is
+    // only copied when it goes into a slot. insert(std::string&&) moves the
+    // string in instead, and emplace() builds the slot's key from the view.
     bool insert( const std::string& v );
-    bool member( const std::string& v );
-    bool remove( const std::string& v);
+    bool insert( std::string&& v );
+    bool emplace( std::string_view v );
+    bool member( std::string_view v );
+    bool remove( std::string_view v );
+
+    // Batched operations. Every group of up to BATCH_GROUP keys is hashed
+    // first and the keys' home slots prefetched, so the cache misses of the
+    // group overlap; then the operations run in order, exactly as the same
+    // calls one by one would. results[i] (if results is not null) is what
+    // the i-th call returns. applyBatch() takes an operation per key.
+    void insertBatch( const std::string_view* keys, std::size_t n, bool* results=nullptr );
+    void memberBatch( const std::string_view* keys, std::size_t n, bool* results=nullptr );
+    void removeBatch( const std::string_view* keys, std::size_t n, bool* results=nullptr );
+    void applyBatch( const BATCH_OP* ops, const std::string_view* keys, std::size_t n, bool* results=nullptr );
+    static constexpr std::size_t BATCH_GROUP = 64;
+
     [[nodiscard]] bool empty() const;
     [[nodiscard]] std::size_t size() const;
     void printStats() const;
@@ -36,47 +251,218 @@ public:
 
     void clear();
     std::string csvStats();
-    static std::string csvStatsHeader();
 
+    // How many slots each operation's probe sequences visited, one sample
+    // per operation (during an incremental compaction or a resize one may
+    // probe both tables; the sample is the two added up). Empty with NoStats.
+    [[nodiscard]] const LengthHistogram& probeLengths( PROBE_OP op ) const {
+        flushProbeSample();
+        return probeLengthsByOp[op];
+    }
+    // The runs of occupied slots in the live table, from a bitmap of the
+    // slot states. O(TABLE_SIZE), so for reports rather than every call.
+    [[nodiscard]] ClusterStats clusterStats() const;
+    [[nodiscard]] TableStats stats() const;
 
-private:
+
+protected:
     std::size_t  TABLE_SIZE;
+    // fastmod multipliers for TABLE_SIZE and TABLE_SIZE - 1 (see KeyHash.hpp)
+    std::uint64_t tableSizeMultiplier;
+    std::uint64_t stepRangeMultiplier;
     PROBE_TYPE probeType;
+    DELETE_TYPE deleteType = TOMBSTONE;
+    HASH_TYPE hashType = HashPolicy::resolve(WYHASH);
+    KEY_STORAGE keyStorage = STRING_SLOTS;
 
-    std::vector<std::string> hashTable;
+    KeyStore hashTable;
     std::vector<ELEMENT_STATUS> hashTableMask;
+    std::vector<std::uint32_t> probeDistance;   // ROBIN_HOOD only
+
+    // The hash code of the key in every USED slot. The home slot comes from
+    // the low 32 bits and the DOUBLE step from the high 32 bits (see
+    // homeSlot() and probeStep()). A probe only compares strings when the
+    // codes match, and compaction re-places keys from the stored codes
+    // without hashing a string again.
+    std::vector<std::uint64_t> slotHash;
+
+    // What one probe sequence found: the slot that holds v, or else the slot
+    // v would go into, and v's hash code.
+    struct ProbeResult {
+        std::size_t idx;
+        bool found;
+        std::uint64_t hash;
+    };
 
     std::vector<char> beforeCompaction, afterCompaction;
 
-    std::size_t primaryHashFunction( const std::string&  v );
-    std::size_t secondaryHashFunction( const std::string&  v );
-    std::size_t memberHelper( const std::string& v );
+    // The probe type and hasher in effect; constants unless a policy is Runtime.
+    [[nodiscard]] PROBE_TYPE probe() const { return ProbePolicy::resolve(probeType); }
+    [[nodiscard]] HASH_TYPE hasher() const { return HashPolicy::resolve(hashType); }
+
+    // A table size with its fastmod multipliers. While a resize is under
+    // way the table being drained has a different size from the live one,
+    // so a probe of it walks its own range.
+    struct SlotRange {
+        std::size_t size;
+        std::uint64_t sizeMultiplier;
+        std::uint64_t stepMultiplier;
+    };
+    [[nodiscard]] SlotRange liveRange() const { return {TABLE_SIZE, tableSizeMultiplier, stepRangeMultiplier}; }
+    void setTableSize( std::size_t tableSize_ );
+
+    std::size_t primaryHashFunction( std::string_view v );
+    std::size_t secondaryHashFunction( std::string_view v );
+    std::uint64_t hashCode( std::string_view v );
+    [[nodiscard]] std::size_t homeSlot( std::uint64_t hash, const SlotRange& range ) const {
+        return fastmod32(static_cast<std::uint32_t>(hash), range.sizeMultiplier,
+            static_cast<std::uint32_t>(range.size));
+    }
+    [[nodiscard]] std::size_t probeStep( std::uint64_t hash, const SlotRange& range ) const {
+        return probe() != DOUBLE ? 1 : 1 + fastmod32(static_cast<std::uint32_t>(hash >> 32), range.stepMultiplier,
+            static_cast<std::uint32_t>(range.size - 1));
+    }
+    // idx + step, wrapped; step < size, so one subtraction does it.
+    [[nodiscard]] static std::size_t advanceSlot( std::size_t idx, std::size_t step, const SlotRange& range ) {
+        idx += step;
+        return idx >= range.size ? idx - range.size : idx;
+    }
+    [[nodiscard]] std::size_t homeSlot( std::uint64_t hash ) const { return homeSlot(hash, liveRange()); }
+    [[nodiscard]] std::size_t probeStep( std::uint64_t hash ) const { return probeStep(hash, liveRange()); }
+    [[nodiscard]] std::size_t advanceSlot( std::size_t idx, std::size_t step ) const {
+        return advanceSlot(idx, step, liveRange());
+    }
+
+    ProbeResult memberHelper( std::string_view v, PROBE_OP op=PROBE_LOOKUP );
+    // insert(), member() and remove() once v's hash code is known. Key is
+    // std::string_view or std::string; the latter is moved into its slot.
+    template<class Key> bool insertKey( Key&& v, std::uint64_t hash );
+    bool findKey( std::string_view v, std::uint64_t hash );
+    bool removeKey( std::string_view v, std::uint64_t hash );
+    void prefetchHome( std::uint64_t hash ) const;
+    template<class OpAt> void runBatch( OpAt opAt, const std::string_view* keys, std::size_t n, bool* results );
+    ProbeResult probeFor( std::string_view v, std::uint64_t hash, const SlotRange& range, const KeyStore& keys,
+        const std::vector<ELEMENT_STATUS>& mask, const std::vector<std::uint64_t>& hashes );
+    [[nodiscard]] std::size_t firstFreeSlot( std::uint64_t hash ) const;
+    std::size_t robinHoodFind( std::string_view v, std::uint64_t hash );
+    template<class Key> bool robinHoodInsert( Key&& v, std::uint64_t hash );
+    void robinHoodShiftIn( std::size_t idx, std::size_t dist, std::uint64_t hash );
+    bool robinHoodRemove( std::string_view v, std::uint64_t hash );
+    void backwardShift( std::size_t hole );
+    [[nodiscard]] const char* probeTypeName() const;
+    [[nodiscard]] const char* hashTypeName() const;
+    [[nodiscard]] double keyBytesPerKey() const;
     [[nodiscard]] double effectiveLoadFactor() const;
 
+    // Slot-level primitives shared by insert()/remove() and by caches that
+    // keep their own per-slot bookkeeping (see LruCache).
+    void placeKey( std::size_t idx, std::string_view v, std::uint64_t hash );
+    void placeKey( std::size_t idx, std::string&& v, std::uint64_t hash );
+    void occupySlot( std::size_t idx, std::uint64_t hash );
+    void vacateSlot( std::size_t idx );
+
     void compactTable();
+    void compactInPlace();
+    void startCompaction();
+    void compactionStep();
+    void drainCompactionSource();
+    std::size_t findInCompactionSource( std::string_view v, std::uint64_t hash );
+    bool removeFromCompactionSource( std::string_view v, std::uint64_t hash );
+    void maybeResize();
+    void startResize( std::size_t newTableSize );
+    void growFullTable();
+    void finishResize();
+    void recordCompactionPause( std::int64_t pauseNs );
+    static std::int64_t pauseClockNs();
 
     double compactionTriggerEffectiveRate = 0.95;
 
     bool shouldCompact = false;
+    COMPACTION_TYPE compactionType = REBUILD;
 
-    std::int64_t numLookups = 0;
-    std::int64_t numDeletes = 0;
-    std::int64_t numInserts = 0;
+    // Incremental compaction and resizing: the table being drained and how
+    // far the drain has got. Keys are in exactly one of the two tables.
+    std::size_t compactionSlotsPerStep = 64;
+    bool compacting = false;
+    std::size_t compactionCursor = 0;
+    KeyStore sourceTable;
+    std::vector<ELEMENT_STATUS> sourceTableMask;
+    std::vector<std::uint64_t> sourceSlotHash;
+    SlotRange sourceRange{0, 0, 0};
 
-    int numCompactions = 0;
+    // Automatic resizing (see setAutoResize()); growLoadFactor 0 is off.
+    // clear() goes back to the initial size.
+    std::size_t initialTableSize;
+    double growLoadFactor = 0.0;
+    double shrinkLoadFactor = 0.0;
+    bool resizing = false;      // the drain under way is a resize
 
-    std::int64_t numHits = 0;
-    std::int64_t numMisses = 0;
-    std::int64_t numFullScans = 0;
+    using Counter = typename StatsPolicy::Counter;
 
-    std::int64_t totalProbes = 0;
+    Counter numLookups = 0;
+    Counter numDeletes = 0;
+    Counter numInserts = 0;
 
+    Counter numCompactions = 0;
+    Counter numResizes = 0;
+    Counter numCompactionPauses = 0;
+    Counter maxCompactionPauseNs = 0;
+
+    Counter numHits = 0;
+    Counter numMisses = 0;
+    Counter numFullScans = 0;
+
+    Counter totalProbes = 0;
+    Counter numStringComparesAvoided = 0;   // USED slots skipped on a hash code mismatch
+
+    // The operation under way, whose probe lengths recordProbes() adds up.
+    // Its sample goes into the histogram when the next operation begins,
+    // or when the histograms are read.
+    PROBE_OP currentProbeOp = PROBE_LOOKUP;
+    mutable std::int64_t pendingProbes = 0;
+    mutable LengthHistogram probeLengthsByOp[NUM_PROBE_OPS];
+    void beginOp( PROBE_OP op ) {
+        if constexpr (StatsPolicy::enabled) {
+            flushProbeSample();
+            currentProbeOp = op;
+        }
+    }
+    void recordProbes( std::int64_t numProbes ) {
+        totalProbes += numProbes;
+        if constexpr (StatsPolicy::enabled)
+            pendingProbes += numProbes;
+    }
+    void flushProbeSample() const {
+        if (pendingProbes == 0)
+            return;
+        probeLengthsByOp[currentProbeOp].record(static_cast<std::uint64_t>(pendingProbes));
+        pendingProbes = 0;
+    }
+    Counter totalShifts = 0;   // keys moved by ROBIN_HOOD and BACKWARD_SHIFT
+
+    // These two drive compaction and size(), so they are always kept.
     std::int64_t numberOfActive = 0;
     std::int64_t numberOfTombstones = 0;
-    std::int64_t maxTombstones = 0;
+    Counter maxTombstones = 0;
 
-    std::int64_t maxValuesInTable = 0;
+    Counter maxValuesInTable = 0;
 };
 
+// The table as it has always been: every option chosen at run time, every
+// counter kept. LruCache and main.cpp use it.
+using HashTableDictionary = BasicHashTableDictionary<RuntimeProbe, RuntimeHasher, FullStats>;
+
+// Fixed-policy tables for production use: no counters, probing inlined.
+using LinearProbingDictionary = BasicHashTableDictionary<LinearProbe, WyHasher, NoStats>;
+using DoubleHashingDictionary = BasicHashTableDictionary<DoubleProbe, WyHasher, NoStats>;
+using RobinHoodDictionary = BasicHashTableDictionary<RobinHoodProbe, WyHasher, NoStats>;
+
+// The member functions are defined in HashTableDictionary.cpp, which
+// instantiates exactly these.
+extern template class BasicHashTableDictionary<RuntimeProbe, RuntimeHasher, FullStats>;
+extern template class BasicHashTableDictionary<LinearProbe, WyHasher, NoStats>;
+extern template class BasicHashTableDictionary<DoubleProbe, WyHasher, NoStats>;
+extern template class BasicHashTableDictionary<RobinHoodProbe, WyHasher, NoStats>;
+
 
 #endif //HASHTABLESOPENADDRESSING_HASHTABLEDICTIONARY_HPP
@@ -0,0 +1,124 @@
+#ifndef HASHTABLESOPENADDRESSING_KEYHASH_HPP
+#define HASHTABLESOPENADDRESSING_KEYHASH_HPP
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
+
+// The string hashers the tables can be built with. They live here, outside
+// the table classes, so that hash_bench can time them on their own.
+
+// The original hash: a base-`base` polynomial of the characters, reduced
+// modulo `modulus` after every character. One integer division per
+// character, and a second pass for the double-hashing step.
+inline std::size_t polynomialHash(std::string_view v, std::size_t base, std::size_t modulus) {
+    std::size_t idx = 0;
+    for (unsigned char c : v) {
+        idx = (idx * base + c) % modulus;
+    }
+    return idx;
+}
+
+// wyhash (final version 4, Wang Yi, public domain), without the 128-bit
+// "condom" variants. One pass over the key, eight bytes at a time, and a
+// handful of 64x64->128 bit multiplies; every output bit depends on every
+// input bit, so both the home slot and the probe step can be cut from the
+// one value.
+namespace wyhash_detail {
+    constexpr std::uint64_t secret0 = 0xa0761d6478bd642fULL;
+    constexpr std::uint64_t secret1 = 0xe7037ed1a0b428dbULL;
+    constexpr std::uint64_t secret2 = 0x8ebc6af09c88c6e3ULL;
+    constexpr std::uint64_t secret3 = 0x589965cc75374cc3ULL;
+
+    inline void mum(std::uint64_t& a, std::uint64_t& b) {
+        const __uint128_t r = static_cast<__uint128_t>(a) * b;
+        a = static_cast<std::uint64_t>(r);
+        b = static_cast<std::uint64_t>(r >> 64);
+    }
+
+    inline std::uint64_t mix(std::uint64_t a, std::uint64_t b) {
+        mum(a, b);
+        return a ^ b;
+    }
+
+    inline std::uint64_t read8(const unsigned char* p) {
+        std::uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline std::uint64_t read4(const unsigned char* p) {
+        std::uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    // 1..3 bytes: first, middle and last byte.
+    inline std::uint64_t read3(const unsigned char* p, std::size_t len) {
+        return (static_cast<std::uint64_t>(p[0]) << 16) |
+               (static_cast<std::uint64_t>(p[len >> 1]) << 8) | p[len - 1];
+    }
+}
+
+inline std::uint64_t wyhash64(const char* key, std::size_t len, std::uint64_t seed = 0) {
+    using namespace wyhash_detail;
+    const auto* p = reinterpret_cast<const unsigned char*>(key);
+    seed ^= mix(seed ^ secret0, secret1);
+
+    std::uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        std::size_t i = len;
+        if (i > 48) {
+            std::uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = mix(read8(p) ^ secret1, read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ secret2, read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ secret3, read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read8(p) ^ secret1, read8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+
+    a ^= secret1;
+    b ^= seed;
+    mum(a, b);
+    return mix(a ^ secret0 ^ len, b ^ secret1);
+}
+
+inline std::uint64_t wyhash64(std::string_view v, std::uint64_t seed = 0) {
+    return wyhash64(v.data(), v.size(), seed);
+}
+
+// Lemire's fastmod (Lemire, Kaser and Kurz, "Faster Remainder by Direct
+// Computation", 2019): with the multiplier computed once for a divisor d,
+// a % d for 32-bit a and d is two multiplies and no division.
+inline std::uint64_t fastmodMultiplier(std::uint32_t d) {
+    return UINT64_C(0xFFFFFFFFFFFFFFFF) / d + 1;
+}
+
+inline std::uint32_t fastmod32(std::uint32_t a, std::uint64_t multiplier, std::uint32_t d) {
+    const std::uint64_t lowbits = multiplier * a;
+    return static_cast<std::uint32_t>((static_cast<__uint128_t>(lowbits) * d) >> 64);
+}
+
+#endif //HASHTABLESOPENADDRESSING_KEYHASH_HPP
@@ -0,0 +1,148 @@
+#include "KeyStore.hpp"
+#include<iostream>
+#include<cstdlib>
+#include<cstring>
+
+KeyStore::KeyStore(std::size_t numSlots_, bool useArena): numSlots{numSlots_}, arenaMode{useArena} {
+    reset();
+}
+
+void KeyStore::reset() {
+    if (arenaMode) {
+        refs.assign(numSlots + 1, KeyRef{NO_KEY, 0});
+        arena.clear();
+        liveBytes = 0;
+    } else {
+        strings.clear();
+        strings.resize(numSlots + 1);
+    }
+}
+
+bool KeyStore::equals(std::size_t idx, std::string_view v) const {
+    if (!arenaMode)
+        return strings.at(idx) == v;
+    const KeyRef ref = refs.at(idx);
+    return ref.length == v.size() && std::memcmp(arena.data() + ref.offset, v.data(), v.size()) == 0;
+}
+
+std::string_view KeyStore::at(std::size_t idx) const {
+    if (!arenaMode)
+        return strings.at(idx);
+    const KeyRef ref = refs.at(idx);
+    return {arena.data() + ref.offset, ref.length};
+}
+
+std::uint32_t KeyStore::append(const char* bytes, std::size_t length) {
+    // Repack rather than grow when half the arena is garbage. bytes may
+    // point into another store's arena, never into this one.
+    if (arena.size() + length > arena.capacity() && arena.size() - liveBytes >= liveBytes)
+        repack();
+    if (arena.size() + length >= NO_KEY) {
+        std::cout << "Key arena is over 4 GB. Terminating\n";
+        exit(1);
+    }
+    const auto offset = static_cast<std::uint32_t>(arena.size());
+    arena.insert(arena.end(), bytes, bytes + length);
+    liveBytes += length;
+    return offset;
+}
+
+void KeyStore::assign(std::size_t idx, std::string_view v) {
+    if (!arenaMode) {
+        strings.at(idx).assign(v.data(), v.size());
+        return;
+    }
+    release(idx);
+    const std::uint32_t offset = append(v.data(), v.size());
+    refs.at(idx) = KeyRef{offset, static_cast<std::uint32_t>(v.size())};
+}
+
+void KeyStore::assign(std::size_t idx, std::string&& v) {
+    if (!arenaMode)
+        strings.at(idx) = std::move(v);
+    else
+        assign(idx, std::string_view(v));
+}
+
+void KeyStore::moveFrom(std::size_t idx, KeyStore& from, std::size_t fromIdx) {
+    if (!arenaMode) {
+        strings.at(idx) = std::move(from.strings.at(fromIdx));
+        return;
+    }
+    if (&from == this) {
+        refs.at(idx) = refs.at(fromIdx);
+        refs.at(fromIdx).offset = NO_KEY;
+        return;
+    }
+    const KeyRef ref = from.refs.at(fromIdx);
+    const std::uint32_t offset = append(from.arena.data() + ref.offset, ref.length);
+    refs.at(idx) = KeyRef{offset, ref.length};
+    from.release(fromIdx);
+}
+
+void KeyStore::takeKey(std::size_t idx, std::string& out) {
+    if (!arenaMode)
+        out.swap(strings.at(idx));
+    else
+        out.assign(at(idx));
+}
+
+void KeyStore::release(std::size_t idx) {
+    if (!arenaMode || refs.at(idx).offset == NO_KEY)
+        return;
+    liveBytes -= refs.at(idx).length;
+    refs.at(idx).offset = NO_KEY;
+    // Nothing live is left, so all of it is garbage.
+    if (liveBytes == 0)
+        arena.clear();
+}
+
+void KeyStore::swapSlots(std::size_t i, std::size_t j) {
+    if (arenaMode)
+        std::swap(refs.at(i), refs.at(j));
+    else
+        strings.at(i).swap(strings.at(j));
+}
+
+void KeyStore::swap(KeyStore& other) {
+    std::swap(numSlots, other.numSlots);
+    std::swap(arenaMode, other.arenaMode);
+    strings.swap(other.strings);
+    refs.swap(other.refs);
+    arena.swap(other.arena);
+    spareArena.swap(other.spareArena);
+    std::swap(liveBytes, other.liveBytes);
+}
+
+void KeyStore::repack() {
+    // Copies the live keys, in slot order, to the spare arena and swaps the
+    // two. Once the spare has grown to size this allocates nothing.
+    if (!arenaMode)
+        return;
+    spareArena.clear();
+    spareArena.reserve(liveBytes);
+    for (auto& ref : refs) {
+        if (ref.offset == NO_KEY)
+            continue;
+        const auto offset = static_cast<std::uint32_t>(spareArena.size());
+        spareArena.insert(spareArena.end(), arena.data() + ref.offset, arena.data() + ref.offset + ref.length);
+        ref.offset = offset;
+    }
+    arena.swap(spareArena);
+}
+
+std::size_t KeyStore::bytesUsed() const {
+    if (!arenaMode)
+        return bytesUsed(strings);
+    return refs.capacity() * sizeof(KeyRef) + arena.capacity() + spareArena.capacity();
+}
+
+std::size_t KeyStore::bytesUsed(const std::vector<std::string>& strings) {
+    // A string longer than the SSO buffer owns a heap block of capacity + 1.
+    const std::size_t ssoCapacity = std::string().capacity();
+    std::size_t bytes = strings.capacity() * sizeof(std::string);
+    for (const auto& s : strings)
+        if (s.capacity() > ssoCapacity)
+            bytes += s.capacity() + 1;
+    return bytes;
+}
@@ -0,0 +1,84 @@
+#ifndef HASHTABLESOPENADDRESSING_KEYSTORE_HPP
+#define HASHTABLESOPENADDRESSING_KEYSTORE_HPP
+
+#include<vector>
+#include<string>
+#include<string_view>
+#include <cstdint>
+
+// The keys of an open-addressed table, one per slot.
+//
+// In string mode every slot is a std::string: 32 bytes whether or not the
+// slot is in use, plus a heap block for a key longer than the SSO buffer.
+// In arena mode a slot is an 8-byte offset/length into one contiguous byte
+// arena. A removed key's bytes are garbage until the arena is repacked,
+// which happens when the arena would otherwise grow while at least half of
+// it is garbage, or when the table calls repack() after a compaction.
+//
+// A slot's key is live from assign() until release(), or until moveFrom()
+// moves it to another slot. Only live slots may be read. In string mode a
+// released slot keeps its string until it is assigned again.
+//
+// There is one slot past the end, scratch(), to park a key while keys are
+// being shuffled (see HashTableDictionary::robinHoodShiftIn()).
+
+class KeyStore {
+
+public:
+    KeyStore() = default;
+    KeyStore( std::size_t numSlots_, bool useArena );
+
+    [[nodiscard]] std::size_t size() const { return numSlots; }
+    [[nodiscard]] std::size_t scratch() const { return numSlots; }
+    [[nodiscard]] bool usesArena() const { return arenaMode; }
+
+    [[nodiscard]] bool equals( std::size_t idx, std::string_view v ) const;
+    // Starts loading slot idx into the cache; a hint, with no effect.
+    void prefetch( std::size_t idx ) const {
+        if (arenaMode)
+            __builtin_prefetch(refs.data() + idx);
+        else
+            __builtin_prefetch(strings.data() + idx);
+    }
+    [[nodiscard]] std::string_view at( std::size_t idx ) const;
+
+    void assign( std::size_t idx, std::string_view v );
+    void assign( std::size_t idx, std::string&& v );    // arena mode copies the bytes
+    // Moves the key in from's slot fromIdx to slot idx; from's slot is
+    // released. Between two arenas the bytes are copied, so a compaction
+    // that moves every key into a fresh store leaves the garbage behind.
+    void moveFrom( std::size_t idx, KeyStore& from, std::size_t fromIdx );
+    // Hands slot idx's key to out; the slot must be released next.
+    void takeKey( std::size_t idx, std::string& out );
+    void release( std::size_t idx );
+    void swapSlots( std::size_t i, std::size_t j );
+    void swap( KeyStore& other );
+
+    void reset();       // every slot empty; the arena keeps its capacity
+    void repack();      // arena only: squeeze out the garbage
+
+    // Bytes the keys take: slots, arena and heap blocks.
+    [[nodiscard]] std::size_t bytesUsed() const;
+    [[nodiscard]] static std::size_t bytesUsed( const std::vector<std::string>& strings );
+
+private:
+    struct KeyRef {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+    static constexpr std::uint32_t NO_KEY = 0xFFFFFFFFu;     // offset of a slot without a live key
+
+    std::size_t numSlots = 0;
+    bool arenaMode = false;
+
+    std::vector<std::string> strings;   // string mode
+    std::vector<KeyRef> refs;           // arena mode
+    std::vector<char> arena;
+    std::vector<char> spareArena;       // repack() copies into it, then swaps
+    std::size_t liveBytes = 0;
+
+    std::uint32_t append( const char* bytes, std::size_t length );
+};
+
+
+#endif //HASHTABLESOPENADDRESSING_KEYSTORE_HPP
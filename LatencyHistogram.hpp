@@ -0,0 +1,107 @@
+#ifndef HASHTABLESOPENADDRESSING_LATENCYHISTOGRAM_HPP
+#define HASHTABLESOPENADDRESSING_LATENCYHISTOGRAM_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+// The percentiles the harness reports for one kind of operation, in
+// nanoseconds. recorded is false when none were timed.
+struct LatencySummary {
+    bool recorded = false;
+    std::uint64_t count = 0;
+    std::uint64_t p50 = 0;
+    std::uint64_t p90 = 0;
+    std::uint64_t p99 = 0;
+    std::uint64_t p999 = 0;
+    std::uint64_t max = 0;
+};
+
+// A log-linear histogram of latencies in nanoseconds. Values below
+// 2 * SUB_BUCKETS each get a bucket; above that, every power of two is
+// split into SUB_BUCKETS equal buckets, so a bucket is at most 1/16 of
+// its values wide. record() is a count-leading-zeros, a shift and an
+// increment, and the table is a fixed 8 KB.
+class LatencyHistogram {
+
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr std::size_t SUB_BUCKETS = std::size_t{1} << SUB_BITS;
+    static constexpr std::size_t NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    void record( std::uint64_t ns ) {
+        ++counts[bucketOf(ns)];
+        ++total;
+        if (ns > maxNs)
+            maxNs = ns;
+    }
+
+    void clear() {
+        for (auto& c : counts)
+            c = 0;
+        total = 0;
+        maxNs = 0;
+    }
+
+    [[nodiscard]] std::uint64_t count() const { return total; }
+    [[nodiscard]] std::uint64_t max() const { return maxNs; }
+
+    // The smallest bucket bound that at least fraction q of the values
+    // are at or below, capped at the largest value recorded.
+    [[nodiscard]] std::uint64_t percentile( double q ) const {
+        if (total == 0)
+            return 0;
+        // The rank of the value wanted, 1-based, rounded up.
+        auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total));
+        if (static_cast<double>(rank) < q * static_cast<double>(total))
+            rank++;
+        if (rank == 0)
+            rank = 1;
+
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < NUM_BUCKETS; b++) {
+            seen += counts[b];
+            if (seen >= rank)
+                return upperBound(b) < maxNs ? upperBound(b) : maxNs;
+        }
+        return maxNs;
+    }
+
+    [[nodiscard]] LatencySummary summary() const {
+        LatencySummary s;
+        s.recorded = total > 0;
+        s.count = total;
+        s.p50 = percentile(0.50);
+        s.p90 = percentile(0.90);
+        s.p99 = percentile(0.99);
+        s.p999 = percentile(0.999);
+        s.max = maxNs;
+        return s;
+    }
+
+private:
+    std::uint64_t counts[NUM_BUCKETS] = {};
+    std::uint64_t total = 0;
+    std::uint64_t maxNs = 0;
+
+    static std::size_t bucketOf( std::uint64_t v ) {
+        if (v < SUB_BUCKETS)
+            return static_cast<std::size_t>(v);
+        const int msb = 63 - __builtin_clzll(v);
+        const int shift = msb - SUB_BITS;
+        return static_cast<std::size_t>(shift + 1) * SUB_BUCKETS +
+            static_cast<std::size_t>((v >> shift) - SUB_BUCKETS);
+    }
+
+    // The largest value that falls in bucket b.
+    static std::uint64_t upperBound( std::size_t b ) {
+        const std::size_t group = b / SUB_BUCKETS;
+        if (group <= 1)
+            return b;
+        const std::size_t shift = group - 1;
+        const std::uint64_t lower = static_cast<std::uint64_t>(SUB_BUCKETS + b % SUB_BUCKETS) << shift;
+        return lower + ((std::uint64_t{1} << shift) - 1);
+    }
+};
+
+
+#endif //HASHTABLESOPENADDRESSING_LATENCYHISTOGRAM_HPP
@@ -0,0 +1,162 @@
+#include "LruCache.hpp"
+#include<iostream>
+#include<cstdlib>
+#include<chrono>
+
+LruCache::LruCache(std::size_t capacity_, std::size_t tableSize_, PROBE_TYPE pType,
+    bool doCompact, double compactionFloor):
+    HashTableDictionary(tableSize_, pType, doCompact, compactionFloor),
+    CAPACITY{capacity_}, NIL{TABLE_SIZE}, head{TABLE_SIZE}, tail{TABLE_SIZE} {
+
+    if (pType == ROBIN_HOOD) {
+        std::cout << "LruCache needs keys that stay in their slots; ROBIN_HOOD moves them. Terminating\n";
+        exit(1);
+    }
+    // At least one slot must stay free so that a probe sequence always ends.
+    if (CAPACITY == 0 || CAPACITY >= TABLE_SIZE) {
+        std::cout << "LruCache capacity " << CAPACITY << " does not fit a table of size "
+                  << TABLE_SIZE << ". Terminating\n";
+        exit(1);
+    }
+    prevSlot.resize(TABLE_SIZE, NIL);
+    nextSlot.resize(TABLE_SIZE, NIL);
+}
+
+void LruCache::clear() {
+    HashTableDictionary::clear();
+
+    prevSlot.assign(TABLE_SIZE, NIL);
+    nextSlot.assign(TABLE_SIZE, NIL);
+    head = tail = NIL;
+
+    evictedKey.clear();
+    evictedLast = false;
+
+    numCacheHits = 0;
+    numCacheMisses = 0;
+    numEvictions = 0;
+}
+
+bool LruCache::get(std::string_view key) {
+    const ProbeResult probe = memberHelper(key);
+    numLookups++;
+    if (!probe.found) {
+        numCacheMisses++;
+        return false;
+    }
+
+    numCacheHits++;
+    moveToFront(probe.idx);
+    return true;
+}
+
+bool LruCache::put(std::string_view key) {
+    evictedLast = false;
+
+    // The one probe sequence: it either finds key or the slot key goes into.
+    const ProbeResult probe = memberHelper(key, PROBE_INSERT);
+    if (probe.found) {
+        numCacheHits++;
+        moveToFront(probe.idx);
+        return true;
+    }
+
+    numCacheMisses++;
+    // The victim is USED, so it can't be idx. Turning it into a tombstone
+    // leaves idx a valid place for key.
+    if (size() == CAPACITY)
+        evictTail();
+
+    placeKey(probe.idx, key, probe.hash);
+    linkFront(probe.idx);
+
+    if (shouldCompact && effectiveLoadFactor() > compactionTriggerEffectiveRate) {
+        auto t0 = std::chrono::steady_clock::now();
+        compactCache();
+        auto t1 = std::chrono::steady_clock::now();
+        recordCompactionPause(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        numCompactions++;
+    }
+
+    return false;
+}
+
+bool LruCache::erase(std::string_view key) {
+    const ProbeResult probe = memberHelper(key, PROBE_REMOVE);
+    if (!probe.found)
+        return false;
+
+    unlink(probe.idx);
+    vacateSlot(probe.idx);
+    return true;
+}
+
+void LruCache::linkFront(std::size_t idx) {
+    prevSlot.at(idx) = NIL;
+    nextSlot.at(idx) = head;
+    if (head != NIL)
+        prevSlot.at(head) = idx;
+    else
+        tail = idx;
+    head = idx;
+}
+
+void LruCache::unlink(std::size_t idx) {
+    const std::size_t p = prevSlot.at(idx);
+    const std::size_t n = nextSlot.at(idx);
+    if (p != NIL)
+        nextSlot.at(p) = n;
+    else
+        head = n;
+    if (n != NIL)
+        prevSlot.at(n) = p;
+    else
+        tail = p;
+}
+
+void LruCache::moveToFront(std::size_t idx) {
+    if (idx == head)
+        return;
+    unlink(idx);
+    linkFront(idx);
+}
+
+void LruCache::evictTail() {
+    const std::size_t victim = tail;
+    unlink(victim);
+    // Tombstones are never compared against, so the key can be moved out.
+    hashTable.takeKey(victim, evictedKey);
+    vacateSlot(victim);
+    numEvictions++;
+    evictedLast = true;
+}
+
+void LruCache::compactCache() {
+    // Same idea as HashTableDictionary::compactTable(), but the keys are
+    // re-inserted from the least to the most recently used one so that the
+    // rebuilt list has the same order.
+    KeyStore oldTable(TABLE_SIZE, keyStorage == ARENA);
+    std::vector<ELEMENT_STATUS> oldMask(TABLE_SIZE, AVAILABLE);
+    std::vector<std::uint64_t> oldHashes(TABLE_SIZE, 0);
+    std::vector<std::size_t> oldPrev(TABLE_SIZE, NIL);
+    hashTable.swap(oldTable);
+    hashTableMask.swap(oldMask);
+    slotHash.swap(oldHashes);
+    prevSlot.swap(oldPrev);
+    nextSlot.assign(TABLE_SIZE, NIL);
+
+    const std::size_t oldTail = tail;
+    head = tail = NIL;
+
+    numberOfTombstones = 0;
+
+    // The keys are distinct, so each one goes to the first free slot its
+    // stored hash code leads to; nothing is hashed or compared.
+    for (std::size_t i = oldTail; i != NIL; i = oldPrev.at(i)) {
+        const std::size_t idx = firstFreeSlot(oldHashes.at(i));
+        hashTable.moveFrom(idx, oldTable, i);
+        slotHash.at(idx) = oldHashes.at(i);
+        hashTableMask.at(idx) = USED;
+        linkFront(idx);
+    }
+}
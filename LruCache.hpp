@@ -0,0 +1,81 @@
+#ifndef HASHTABLESOPENADDRESSING_LRUCACHE_HPP
+#define HASHTABLESOPENADDRESSING_LRUCACHE_HPP
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "HashTableDictionary.hpp"
+
+// An LRU cache of string keys that lives directly in the open-addressed
+// slots of HashTableDictionary. The recency list is intrusive: every USED
+// slot carries the slot index of its more-recent (prev) and less-recent
+// (next) neighbour, so there are no list nodes and no second copy of a key.
+//
+// get() and put() run exactly one probe sequence. Evicting on a full cache
+// does not probe at all; the victim is the slot at the tail of the list.
+//
+// The cache owns its tombstone clean-up because compaction moves keys to
+// new slots and the links have to move with them. That is also why the
+// table is inherited non-publicly: a direct insert()/remove() on the base
+// would bypass the links.
+
+class LruCache : protected HashTableDictionary {
+
+public:
+    LruCache( std::size_t capacity_, std::size_t tableSize_,
+        PROBE_TYPE probeType, bool doCompact=true, double compactionTriggerRate=0.95);
+
+    using HashTableDictionary::size;
+    using HashTableDictionary::empty;
+    using HashTableDictionary::printStats;
+    using HashTableDictionary::csvStats;
+    using HashTableDictionary::csvStatsHeader;
+    using HashTableDictionary::setKeyStorage;   // before the first put()
+
+    // Returns true on a hit and makes key the most recently used entry.
+    bool get( std::string_view key );
+
+    // Returns true if key was already resident. On a miss key is inserted
+    // as the most recently used entry; if the cache is full, the least
+    // recently used entry is evicted first (see lastEvicted()).
+    bool put( std::string_view key );
+
+    bool erase( std::string_view key );
+
+    void clear();
+
+    [[nodiscard]] std::size_t capacity() const { return CAPACITY; }
+    [[nodiscard]] bool evictedOnLastPut() const { return evictedLast; }
+    [[nodiscard]] const std::string& lastEvicted() const { return evictedKey; }
+
+    [[nodiscard]] std::int64_t hits() const { return numCacheHits; }
+    [[nodiscard]] std::int64_t misses() const { return numCacheMisses; }
+    [[nodiscard]] std::int64_t evictions() const { return numEvictions; }
+
+private:
+    std::size_t CAPACITY;
+    const std::size_t NIL;              // "no slot"; equals TABLE_SIZE
+
+    std::vector<std::size_t> prevSlot;  // towards the most recently used end
+    std::vector<std::size_t> nextSlot;  // towards the least recently used end
+    std::size_t head;                   // most recently used slot
+    std::size_t tail;                   // least recently used slot
+
+    std::string evictedKey;
+    bool evictedLast = false;
+
+    std::int64_t numCacheHits = 0;
+    std::int64_t numCacheMisses = 0;
+    std::int64_t numEvictions = 0;
+
+    void linkFront( std::size_t idx );
+    void unlink( std::size_t idx );
+    void moveToFront( std::size_t idx );
+    void evictTail();
+    void compactCache();
+};
+
+
+#endif //HASHTABLESOPENADDRESSING_LRUCACHE_HPP
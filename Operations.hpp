@@ -5,20 +5,22 @@
 #pragma once
 #include <cassert>
 #include <string>
+#include <string_view>
 #include <iostream>
 
 enum class OpCode {
     Insert,     // I key
-    Erase  // E key (delete a key)
+    Erase,  // E key (delete a key)
+    Lookup  // L key (look a key up)
   };
 
 struct Operation {
     OpCode tag;
     std::string key;
 
-    // Either of the two op_codes take a string argument.
+    // All three op_codes take a string argument.
     Operation(OpCode op_code, const std::string &k) : tag(op_code), key(k) {
-        assert(op_code == OpCode::Insert || op_code == OpCode::Erase);
+        assert(op_code == OpCode::Insert || op_code == OpCode::Erase || op_code == OpCode::Lookup);
     }
 
     void print() const {
@@ -29,6 +31,9 @@ struct Operation {
             case OpCode::Erase:
                 std::cout << "E " << key << std::endl;
                 break;
+            case OpCode::Lookup:
+                std::cout << "L " << key << std::endl;
+                break;
             default:
                 std::cout << "Unknown operation: " << static_cast<int>(tag) << std::endl;
         }
@@ -37,4 +42,15 @@ struct Operation {
     // Identify the instance
     [[nodiscard]] bool isInsert()     const { return tag == OpCode::Insert; }
     [[nodiscard]] bool isFindMin()    const { return tag == OpCode::Erase; }
+    [[nodiscard]] bool isLookup()     const { return tag == OpCode::Lookup; }
+};
+
+// An operation whose key lives elsewhere: in an Operation, or in a mapped
+// binary trace (see TraceFiles.hpp). The harness replays these.
+struct OperationView {
+    OpCode tag;
+    std::string_view key;
+
+    OperationView(OpCode op_code, std::string_view k) : tag(op_code), key(k) {}
+    explicit OperationView(const Operation& op) : tag(op.tag), key(op.key) {}
 };
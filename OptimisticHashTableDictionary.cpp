@@ -0,0 +1,500 @@
+#include "OptimisticHashTableDictionary.hpp"
+#include<iostream>
+#include<iomanip>
+#include<algorithm>
+#include<chrono>
+#include<thread>
+#include<cstring>
+#include<new>
+
+namespace {
+    // Threads take stripes round robin, the first time they read.
+    std::size_t readerStripeIndex() {
+        static std::atomic<std::size_t> nextStripe{0};
+        thread_local const std::size_t stripe =
+            nextStripe.fetch_add(1, std::memory_order_relaxed) % OptimisticHashTableDictionary::NUM_STRIPES;
+        return stripe;
+    }
+
+    std::int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+const OptimisticHashTableDictionary::KeyBlock OptimisticHashTableDictionary::DELETED_BLOCK{0, 0};
+
+OptimisticHashTableDictionary::Table::Table(std::size_t size_):
+    size{size_}, sizeMultiplier{fastmodMultiplier(static_cast<std::uint32_t>(size_))},
+    stepMultiplier{fastmodMultiplier(static_cast<std::uint32_t>(size_ - 1))},
+    slots{new std::atomic<const KeyBlock*>[size_]} {
+    for (std::size_t i = 0; i < size; i++)
+        slots[i].store(nullptr, std::memory_order_relaxed);
+}
+
+OptimisticHashTableDictionary::OptimisticHashTableDictionary(std::size_t tableSize_, PROBE_TYPE pType,
+    bool doCompact, double compactionFloor, double growAt):
+    probeType{pType}, initialTableSize{nextPrime(tableSize_)}, shouldCompact{doCompact},
+    compactionTriggerEffectiveRate{compactionFloor}, growLoadFactor{growAt} {
+    if (probeType == ROBIN_HOOD) {
+        std::cout << "The optimistic table supports SINGLE and DOUBLE probing only. Terminating\n";
+        exit(1);
+    }
+    if (growLoadFactor <= 0.0 || growLoadFactor >= 1.0) {
+        std::cout << "Growing needs 0 < growAt < 1. Terminating\n";
+        exit(1);
+    }
+    if (initialTableSize > 0xFFFFFFFFu) {
+        std::cout << "Table size " << initialTableSize << " does not fit in 32 bits. Terminating\n";
+        exit(1);
+    }
+    table.store(new Table(initialTableSize), std::memory_order_release);
+}
+
+OptimisticHashTableDictionary::~OptimisticHashTableDictionary() {
+    // No reader may still be running.
+    Table* t = table.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < t->size; i++) {
+        const KeyBlock* b = t->slots[i].load(std::memory_order_relaxed);
+        if (b != nullptr && b != &DELETED_BLOCK)
+            freeBlock(b);
+    }
+    delete t;
+    for (int parity = 0; parity < 2; parity++) {
+        for (const KeyBlock* b : retiredBlocks[parity])
+            freeBlock(b);
+        for (Table* old : retiredTables[parity])
+            delete old;
+    }
+}
+
+const OptimisticHashTableDictionary::KeyBlock* OptimisticHashTableDictionary::makeBlock(std::string_view v,
+    std::uint64_t hash) {
+    if (v.size() > 0xFFFFFFFFu) {
+        std::cout << "Key of " << v.size() << " bytes is over 4 GB. Terminating\n";
+        exit(1);
+    }
+    void* p = ::operator new(sizeof(KeyBlock) + v.size());
+    auto* b = new (p) KeyBlock{hash, static_cast<std::uint32_t>(v.size())};
+    std::memcpy(reinterpret_cast<char*>(b + 1), v.data(), v.size());
+    return b;
+}
+
+void OptimisticHashTableDictionary::freeBlock(const KeyBlock* b) {
+    ::operator delete(const_cast<KeyBlock*>(b));
+}
+
+bool OptimisticHashTableDictionary::holds(const KeyBlock* b, std::string_view v, std::uint64_t hash) {
+    return b != &DELETED_BLOCK && b->hash == hash && b->length == v.size() &&
+           std::memcmp(b->bytes(), v.data(), v.size()) == 0;
+}
+
+std::size_t OptimisticHashTableDictionary::homeSlot(const Table& t, std::uint64_t hash) const {
+    return fastmod32(static_cast<std::uint32_t>(hash), t.sizeMultiplier, static_cast<std::uint32_t>(t.size));
+}
+
+std::size_t OptimisticHashTableDictionary::probeStep(const Table& t, std::uint64_t hash) const {
+    return probeType != DOUBLE ? 1 : 1 + fastmod32(static_cast<std::uint32_t>(hash >> 32), t.stepMultiplier,
+        static_cast<std::uint32_t>(t.size - 1));
+}
+
+// ------------------------------------------------------------------
+// Readers
+// ------------------------------------------------------------------
+
+std::uint64_t OptimisticHashTableDictionary::enterEpoch(ReaderStripe& stripe) {
+    // Count in under the epoch as it is after the increment; if the epoch
+    // moved on in between, the writer may not have seen this reader.
+    for (;;) {
+        const std::uint64_t e = epoch.load(std::memory_order_seq_cst);
+        stripe.active[e & 1].fetch_add(1, std::memory_order_seq_cst);
+        if (epoch.load(std::memory_order_seq_cst) == e)
+            return e;
+        stripe.active[e & 1].fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void OptimisticHashTableDictionary::exitEpoch(ReaderStripe& stripe, std::uint64_t e) {
+    stripe.active[e & 1].fetch_sub(1, std::memory_order_release);
+}
+
+std::size_t OptimisticHashTableDictionary::readerFind(const Table& t, std::string_view v, std::uint64_t hash,
+    std::int64_t& probes) const {
+    // Returns the slot that holds v, or t.size. During a rewrite the slots
+    // may be half re-placed; any block loaded is still allocated, and the
+    // caller throws the answer away.
+    std::size_t idx = homeSlot(t, hash);
+    const std::size_t step = probeStep(t, hash);
+    for (std::size_t n = 0; n < t.size; n++) {
+        probes++;
+        const KeyBlock* b = t.slots[idx].load(std::memory_order_acquire);
+        if (b == nullptr)
+            return t.size;
+        if (holds(b, v, hash))
+            return idx;
+        idx += step;
+        if (idx >= t.size)
+            idx -= t.size;
+    }
+    return t.size;
+}
+
+bool OptimisticHashTableDictionary::member(std::string_view v) {
+    const std::uint64_t hash = wyhash64(v);
+    ReaderStripe& stripe = stripes[readerStripeIndex()];
+    const std::uint64_t e = enterEpoch(stripe);
+
+    std::int64_t probes = 0;
+    bool found;
+    for (;;) {
+        const std::uint64_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            stripe.retries.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+            continue;
+        }
+        const Table& t = *table.load(std::memory_order_acquire);
+        found = readerFind(t, v, hash, probes) != t.size;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before)
+            break;
+        stripe.retries.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    stripe.lookups.fetch_add(1, std::memory_order_relaxed);
+    stripe.probes.fetch_add(probes, std::memory_order_relaxed);
+    exitEpoch(stripe, e);
+    return found;
+}
+
+// ------------------------------------------------------------------
+// The writer
+// ------------------------------------------------------------------
+
+std::size_t OptimisticHashTableDictionary::writerFind(const Table& t, std::string_view v, std::uint64_t hash,
+    bool& found) {
+    // Returns the slot that holds v, or else the slot v would go into.
+    std::size_t idx = homeSlot(t, hash);
+    const std::size_t step = probeStep(t, hash);
+    std::size_t firstDeleteIdx = t.size;
+    std::size_t n = 0;
+    found = false;
+    for (; n < t.size; n++) {
+        const KeyBlock* b = t.slots[idx].load(std::memory_order_relaxed);
+        if (b == nullptr)
+            break;
+        if (b == &DELETED_BLOCK) {
+            if (firstDeleteIdx == t.size)
+                firstDeleteIdx = idx;
+        } else if (holds(b, v, hash)) {
+            found = true;
+            break;
+        }
+        idx += step;
+        if (idx >= t.size)
+            idx -= t.size;
+    }
+    writerProbes += static_cast<std::int64_t>(std::min(n + 1, t.size));
+    if (n == t.size)
+        numFullScans++;
+    if (!found && firstDeleteIdx != t.size)
+        idx = firstDeleteIdx;
+    return idx;
+}
+
+void OptimisticHashTableDictionary::placeBlock(Table& t, std::size_t idx, std::size_t step, const KeyBlock* b) {
+    // The first empty slot from idx on. Only for tables without tombstones
+    // that readers are told to ignore (see beginRewrite()).
+    while (t.slots[idx].load(std::memory_order_relaxed) != nullptr) {
+        idx += step;
+        if (idx >= t.size)
+            idx -= t.size;
+    }
+    t.slots[idx].store(b, std::memory_order_release);
+}
+
+bool OptimisticHashTableDictionary::insert(const std::string& v) {
+    return emplace(v);
+}
+
+bool OptimisticHashTableDictionary::insert(std::string&& v) {
+    // The bytes are copied into a block either way.
+    return emplace(v);
+}
+
+bool OptimisticHashTableDictionary::emplace(std::string_view v) {
+    std::lock_guard<std::mutex> guard(writerLock);
+    const std::uint64_t hash = wyhash64(v);
+    Table& t = *table.load(std::memory_order_relaxed);
+
+    bool found;
+    const std::size_t idx = writerFind(t, v, hash, found);
+    if (found)
+        return false;
+
+    const KeyBlock* b = makeBlock(v, hash);
+    if (t.slots[idx].load(std::memory_order_relaxed) == &DELETED_BLOCK)
+        numberOfTombstones--;
+    t.slots[idx].store(b, std::memory_order_release);
+    blockBytes += sizeof(KeyBlock) + v.size();
+    numberOfActive.fetch_add(1, std::memory_order_relaxed);
+    numInserts++;
+    const std::int64_t active = numberOfActive.load(std::memory_order_relaxed);
+    maxValuesInTable = std::max(maxValuesInTable, active);
+
+    if (static_cast<double>(active) > growLoadFactor * static_cast<double>(t.size))
+        grow();
+    else if (shouldCompact && static_cast<double>(active + numberOfTombstones) >
+                              compactionTriggerEffectiveRate * static_cast<double>(t.size))
+        compactInPlace();
+    return true;
+}
+
+bool OptimisticHashTableDictionary::remove(std::string_view v) {
+    std::lock_guard<std::mutex> guard(writerLock);
+    const std::uint64_t hash = wyhash64(v);
+    Table& t = *table.load(std::memory_order_relaxed);
+
+    bool found;
+    const std::size_t idx = writerFind(t, v, hash, found);
+    if (!found)
+        return false;
+
+    // Readers may still be comparing against the block.
+    const KeyBlock* b = t.slots[idx].load(std::memory_order_relaxed);
+    t.slots[idx].store(&DELETED_BLOCK, std::memory_order_release);
+    blockBytes -= sizeof(KeyBlock) + b->length;
+    retire(b);
+    numberOfTombstones++;
+    numberOfActive.fetch_sub(1, std::memory_order_relaxed);
+    numDeletes++;
+    tryReclaim(false);
+    return true;
+}
+
+void OptimisticHashTableDictionary::beginRewrite() {
+    // Seqlock write side: odd while keys move, so readers retry.
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void OptimisticHashTableDictionary::endRewrite() {
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void OptimisticHashTableDictionary::gatherLiveBlocks(const Table& t) {
+    liveBlocks.clear();
+    for (std::size_t i = 0; i < t.size; i++) {
+        const KeyBlock* b = t.slots[i].load(std::memory_order_relaxed);
+        if (b != nullptr && b != &DELETED_BLOCK)
+            liveBlocks.push_back(b);
+    }
+}
+
+void OptimisticHashTableDictionary::compactInPlace() {
+    // Drops the tombstones by re-placing every key in the same slots
+    // array. Readers wait it out, so it is kept to two passes.
+    const std::int64_t t0 = nowNs();
+    Table& t = *table.load(std::memory_order_relaxed);
+    gatherLiveBlocks(t);
+
+    beginRewrite();
+    for (std::size_t i = 0; i < t.size; i++)
+        t.slots[i].store(nullptr, std::memory_order_relaxed);
+    for (const KeyBlock* b : liveBlocks)
+        placeBlock(t, homeSlot(t, b->hash), probeStep(t, b->hash), b);
+    endRewrite();
+
+    numberOfTombstones = 0;
+    numCompactions++;
+    maxPauseNs = std::max(maxPauseNs, nowNs() - t0);
+}
+
+void OptimisticHashTableDictionary::grow() {
+    // The new table is filled before anyone can see it; readers only
+    // retry for the moment it is swapped in.
+    const std::int64_t t0 = nowNs();
+    Table* old = table.load(std::memory_order_relaxed);
+    const std::size_t newSize = nextPrime(2 * old->size);
+    if (newSize > 0xFFFFFFFFu) {
+        std::cout << "Table size " << newSize << " does not fit in 32 bits. Terminating\n";
+        exit(1);
+    }
+    auto* bigger = new Table(newSize);
+    gatherLiveBlocks(*old);
+    for (const KeyBlock* b : liveBlocks)
+        placeBlock(*bigger, homeSlot(*bigger, b->hash), probeStep(*bigger, b->hash), b);
+
+    beginRewrite();
+    table.store(bigger, std::memory_order_release);
+    endRewrite();
+
+    retire(old);
+    numberOfTombstones = 0;
+    numResizes++;
+    maxPauseNs = std::max(maxPauseNs, nowNs() - t0);
+    tryReclaim(true);
+}
+
+void OptimisticHashTableDictionary::retire(const KeyBlock* b) {
+    retiredBlocks[epoch.load(std::memory_order_relaxed) & 1].push_back(b);
+}
+
+void OptimisticHashTableDictionary::retire(Table* t) {
+    retiredTables[epoch.load(std::memory_order_relaxed) & 1].push_back(t);
+}
+
+void OptimisticHashTableDictionary::tryReclaim(bool force) {
+    // What was retired during epoch e - 1 may be freed once no reader that
+    // counted in during e - 1 is left. Readers that count in later load
+    // the slots after it was unlinked, so they can't have it.
+    const std::uint64_t e = epoch.load(std::memory_order_relaxed);
+    const std::size_t parity = (e - 1) & 1;
+    if (!force && retiredBlocks[e & 1].size() < RECLAIM_BATCH)
+        return;
+    for (const auto& stripe : stripes)
+        if (stripe.active[parity].load(std::memory_order_acquire) != 0)
+            return;
+
+    for (const KeyBlock* b : retiredBlocks[parity])
+        freeBlock(b);
+    numReclaimed += static_cast<std::int64_t>(retiredBlocks[parity].size());
+    retiredBlocks[parity].clear();
+    for (Table* old : retiredTables[parity])
+        delete old;
+    retiredTables[parity].clear();
+
+    epoch.store(e + 1, std::memory_order_seq_cst);
+}
+
+void OptimisticHashTableDictionary::clear() {
+    std::lock_guard<std::mutex> guard(writerLock);
+    Table* t = table.load(std::memory_order_relaxed);
+    gatherLiveBlocks(*t);
+
+    if (t->size == initialTableSize) {
+        beginRewrite();
+        for (std::size_t i = 0; i < t->size; i++)
+            t->slots[i].store(nullptr, std::memory_order_relaxed);
+        endRewrite();
+    } else {
+        beginRewrite();
+        table.store(new Table(initialTableSize), std::memory_order_release);
+        endRewrite();
+        retire(t);
+    }
+    for (const KeyBlock* b : liveBlocks)
+        retire(b);
+    tryReclaim(true);
+
+    numberOfActive.store(0, std::memory_order_relaxed);
+    numberOfTombstones = 0;
+    blockBytes = 0;
+    numInserts = 0;
+    numDeletes = 0;
+    writerProbes = 0;
+    numFullScans = 0;
+    numCompactions = 0;
+    numResizes = 0;
+    maxPauseNs = 0;
+    maxValuesInTable = 0;
+    numReclaimed = 0;
+    for (auto& stripe : stripes) {
+        stripe.lookups.store(0, std::memory_order_relaxed);
+        stripe.probes.store(0, std::memory_order_relaxed);
+        stripe.retries.store(0, std::memory_order_relaxed);
+    }
+}
+
+// ------------------------------------------------------------------
+// Statistics
+// ------------------------------------------------------------------
+
+std::size_t OptimisticHashTableDictionary::size() const {
+    return static_cast<std::size_t>(numberOfActive.load(std::memory_order_relaxed));
+}
+
+bool OptimisticHashTableDictionary::empty() const {
+    return size() == 0;
+}
+
+std::int64_t OptimisticHashTableDictionary::readerRetries() const {
+    std::int64_t retries = 0;
+    for (const auto& stripe : stripes)
+        retries += stripe.retries.load(std::memory_order_relaxed);
+    return retries;
+}
+
+double OptimisticHashTableDictionary::loadFactor() const {
+    const Table& t = *table.load(std::memory_order_acquire);
+    return static_cast<double>(numberOfActive.load(std::memory_order_relaxed)) / static_cast<double>(t.size);
+}
+
+void OptimisticHashTableDictionary::printStats() const {
+    std::int64_t lookups = 0, probes = 0;
+    for (const auto& stripe : stripes) {
+        lookups += stripe.lookups.load(std::memory_order_relaxed);
+        probes += stripe.probes.load(std::memory_order_relaxed);
+    }
+    const int width = 8;
+    const Table& t = *table.load(std::memory_order_acquire);
+    std::cout << std::setw(width) << t.size << " table size." << std::endl;
+    std::cout << std::setw(width) << numberOfTombstones << " cells marked as deleted."  << std::endl;
+    std::cout << std::setw(width) << size() << " active cells."  << std::endl;
+    std::cout << std::setw(width) << maxValuesInTable << " maximum number of values in the table ever." << std::endl;
+    std::cout << std::endl;
+    std::cout << std::setw(width) << numInserts << " inserts."  << std::endl;
+    std::cout << std::setw(width) << numDeletes << " deletes."  << std::endl;
+    std::cout << std::setw(width) << lookups << " lock-free lookups, " << probes << " probes."  << std::endl;
+    std::cout << std::setw(width) << readerRetries() << " lookups retried after a compaction or resize." << std::endl;
+    std::cout << std::setw(width) << numCompactions << " compactions, " << numResizes << " resizes, the longest "
+              << static_cast<double>(maxPauseNs) / 1e3 << " us." << std::endl;
+    std::cout << std::setw(width) << numReclaimed << " removed keys freed so far." << std::endl;
+}
+
+std::string OptimisticHashTableDictionary::csvStats() {
+    // HashTableDictionary's columns. The probes are the readers' and the
+    // writer's together; hash compares are not counted.
+    std::int64_t lookups = 0, probes = writerProbes;
+    for (const auto& stripe : stripes) {
+        lookups += stripe.lookups.load(std::memory_order_relaxed);
+        probes += stripe.probes.load(std::memory_order_relaxed);
+    }
+    const Table& t = *table.load(std::memory_order_acquire);
+    const auto tableSize = static_cast<std::int64_t>(t.size);
+    const auto sizeD = static_cast<double>(tableSize);
+    const std::int64_t active = numberOfActive.load(std::memory_order_relaxed);
+    const std::int64_t available = tableSize - numberOfTombstones - active;
+    const std::size_t keyBytes = t.size * sizeof(std::atomic<const KeyBlock*>) + blockBytes;
+    std::vector<std::uint64_t> occupied((t.size + 63) / 64, 0);
+    for (std::size_t i = 0; i < t.size; i++)
+        occupied[i / 64] |= static_cast<std::uint64_t>(t.slots[i].load(std::memory_order_relaxed) != nullptr) << (i % 64);
+    const LengthHistogram probeLengthsNotKept[NUM_PROBE_OPS];
+    return std::to_string(tableSize) + "," + // table size
+           std::to_string(active) + "," + // active
+           std::to_string(available) + "," + // available
+           std::to_string(numberOfTombstones) + "," + // tombstones
+           std::to_string(probes) + "," + // totalProbes
+           std::to_string(numInserts) + "," + // inserts
+           std::to_string(numDeletes) + "," + // deletes
+           std::to_string(lookups) + "," + // lookups
+           std::to_string(numFullScans) + "," + // full scans
+           std::to_string(numCompactions) + "," + // compactions
+           std::to_string(maxValuesInTable) + "," + // max_in_table
+           std::to_string(static_cast<int>(static_cast<double>(available) / sizeD * 100)) + "," + // ratio available
+           std::to_string(static_cast<int>(static_cast<double>(active) / sizeD * 100)) + "," + // load factor
+           std::to_string(static_cast<int>(static_cast<double>(active + numberOfTombstones) / sizeD * 100)) +
+           "," + // effective load factor
+           std::to_string(static_cast<int>(static_cast<double>(numberOfTombstones) / sizeD * 100)) + "," + // ratio tombstones
+           std::to_string(static_cast<double>(probes) / static_cast<double>(numInserts + numDeletes + lookups)) +
+           (probeType == DOUBLE ? ",double," : ",single,") +
+           (shouldCompact ? "compaction_on" : "compaction_off") +
+           ",in_place," +
+           std::to_string(numCompactions + numResizes) + "," + // compaction pauses
+           std::to_string(static_cast<double>(maxPauseNs) / 1e3) + "," + // longest pause
+           "0,tombstone," + // keys are never shifted
+           "0,wyhash,blocks," + // hash compares are not counted
+           std::to_string(static_cast<double>(keyBytes) / static_cast<double>(std::max<std::int64_t>(active, 1))) +
+           "," + std::to_string(numResizes) +
+           probeStatsCsv(probeLengthsNotKept, occupiedRuns(occupied, t.size));
+}
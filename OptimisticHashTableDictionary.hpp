@@ -0,0 +1,150 @@
+#ifndef HASHTABLESOPENADDRESSING_OPTIMISTICHASHTABLEDICTIONARY_HPP
+#define HASHTABLESOPENADDRESSING_OPTIMISTICHASHTABLEDICTIONARY_HPP
+
+#include<vector>
+#include<string>
+#include<string_view>
+#include<memory>
+#include<mutex>
+#include<atomic>
+#include <cstdint>
+
+#include "HashTableDictionary.hpp"
+
+// A string set for read-mostly workloads. member() takes no lock and
+// writes nothing another reader reads, so readers on different cores don't
+// bounce cache lines between them. Writers (insert, remove, clear) run one
+// at a time; a writer lock makes a second one wait.
+//
+// Every key lives in an immutable heap block (its hash code, its length
+// and its bytes), and a slot is one atomic pointer: null for AVAILABLE, a
+// sentinel block for DELETED, or the key's block. An insert or a remove
+// publishes one pointer, so a reader sees the slot before or after it,
+// never in between, and the block it compares against cannot change.
+//
+// Compaction re-places every key inside the table, and growth moves them
+// into a table twice the size. Both make the sequence counter odd while
+// they run; a reader that saw it odd, or saw it change during its probe,
+// probes again.
+//
+// Removed blocks and replaced tables are freed by epochs. A reader counts
+// itself in for the length of one member(), in one of two counters picked
+// by the epoch's parity, on one of NUM_STRIPES cache lines. What the writer
+// retired during epoch e - 1 is freed once the e - 1 counters have drained
+// to zero, and the epoch moves on to e + 1.
+
+class OptimisticHashTableDictionary : public HashTableCommon {
+
+public:
+    // SINGLE or DOUBLE probing; tableSize_ is rounded up to a prime. The
+    // table grows to about twice its size when the load factor passes
+    // growAt (as HashTableDictionary::setAutoResize()), and compacts in
+    // place when the effective load factor passes compactionTriggerRate.
+    OptimisticHashTableDictionary( std::size_t tableSize_, PROBE_TYPE probeType,
+        bool doCompact=true, double compactionTriggerRate=0.95, double growAt=0.8 );
+    ~OptimisticHashTableDictionary();
+    OptimisticHashTableDictionary( const OptimisticHashTableDictionary& ) = delete;
+    OptimisticHashTableDictionary& operator=( const OptimisticHashTableDictionary& ) = delete;
+
+    // Any number of threads, at the same time as a writer.
+    bool member( std::string_view v );
+
+    bool insert( const std::string& v );
+    bool insert( std::string&& v );
+    bool emplace( std::string_view v );
+    bool remove( std::string_view v );
+    void clear();
+
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] bool empty() const;
+
+    // Read these while no writer is running.
+    [[nodiscard]] std::int64_t readerRetries() const;
+    [[nodiscard]] double loadFactor() const;
+    void printStats() const;
+    std::string csvStats();
+
+    static constexpr std::size_t NUM_STRIPES = 64;
+
+private:
+    struct KeyBlock {
+        std::uint64_t hash;
+        std::uint32_t length;
+        [[nodiscard]] const char* bytes() const { return reinterpret_cast<const char*>(this + 1); }
+    };
+    static const KeyBlock DELETED_BLOCK;
+
+    struct Table {
+        std::size_t size;
+        std::uint64_t sizeMultiplier;
+        std::uint64_t stepMultiplier;
+        std::unique_ptr<std::atomic<const KeyBlock*>[]> slots;
+
+        explicit Table( std::size_t size_ );
+    };
+
+    // A reader's counters live on its own stripe, so it only contends with
+    // the (few) readers that share the stripe.
+    struct alignas(64) ReaderStripe {
+        std::atomic<std::int64_t> active[2] = {{0}, {0}};
+        std::atomic<std::int64_t> lookups{0};
+        std::atomic<std::int64_t> probes{0};
+        std::atomic<std::int64_t> retries{0};
+    };
+
+    PROBE_TYPE probeType;
+    const std::size_t initialTableSize;
+    const bool shouldCompact;
+    const double compactionTriggerEffectiveRate;
+    const double growLoadFactor;
+    static constexpr std::size_t RECLAIM_BATCH = 1024;     // retired blocks before the writer tries to free them
+
+    std::atomic<Table*> table;
+    std::atomic<std::uint64_t> sequence{0};
+    std::atomic<std::uint64_t> epoch{2};
+    ReaderStripe stripes[NUM_STRIPES];
+
+    std::mutex writerLock;
+    std::vector<const KeyBlock*> retiredBlocks[2];     // by the parity of the epoch they were retired in
+    std::vector<Table*> retiredTables[2];
+    std::vector<const KeyBlock*> liveBlocks;            // compaction and growth gather the keys here
+
+    // Written by the writer only.
+    std::atomic<std::int64_t> numberOfActive{0};
+    std::int64_t numberOfTombstones = 0;
+    std::size_t blockBytes = 0;
+    std::int64_t numInserts = 0;
+    std::int64_t numDeletes = 0;
+    std::int64_t writerProbes = 0;
+    std::int64_t numFullScans = 0;
+    std::int64_t numCompactions = 0;
+    std::int64_t numResizes = 0;
+    std::int64_t maxPauseNs = 0;
+    std::int64_t maxValuesInTable = 0;
+    std::int64_t numReclaimed = 0;
+
+    static const KeyBlock* makeBlock( std::string_view v, std::uint64_t hash );
+    static void freeBlock( const KeyBlock* b );
+    static bool holds( const KeyBlock* b, std::string_view v, std::uint64_t hash );
+    [[nodiscard]] std::size_t homeSlot( const Table& t, std::uint64_t hash ) const;
+    [[nodiscard]] std::size_t probeStep( const Table& t, std::uint64_t hash ) const;
+
+    std::size_t readerFind( const Table& t, std::string_view v, std::uint64_t hash, std::int64_t& probes ) const;
+    std::size_t writerFind( const Table& t, std::string_view v, std::uint64_t hash, bool& found );
+    static void placeBlock( Table& t, std::size_t home, std::size_t step, const KeyBlock* b );
+
+    std::uint64_t enterEpoch( ReaderStripe& stripe );
+    static void exitEpoch( ReaderStripe& stripe, std::uint64_t e );
+    void retire( const KeyBlock* b );
+    void retire( Table* t );
+    void tryReclaim( bool force );
+
+    void beginRewrite();
+    void endRewrite();
+    void gatherLiveBlocks( const Table& t );
+    void compactInPlace();
+    void grow();
+};
+
+
+#endif //HASHTABLESOPENADDRESSING_OPTIMISTICHASHTABLEDICTIONARY_HPP
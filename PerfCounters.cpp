@@ -0,0 +1,165 @@
+#include "PerfCounters.hpp"
+#include<cstring>
+#include<cerrno>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* PerfCounts::columnName(EVENT e) {
+    switch (e) {
+        case CYCLES:        return "cycles_per_op";
+        case INSTRUCTIONS:  return "instructions_per_op";
+        case L1D_MISSES:    return "l1d_misses_per_op";
+        case LLC_MISSES:    return "llc_misses_per_op";
+        case DTLB_MISSES:   return "dtlb_misses_per_op";
+        case BRANCH_MISSES: return "branch_misses_per_op";
+        default:            return "";
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+#ifdef __linux__
+
+namespace {
+    // The type and config of each event: hardware events, or cache read
+    // misses (cache id | op << 8 | result << 16).
+    void setEvent(PerfCounts::EVENT e, perf_event_attr& attr) {
+        auto& type = attr.type;
+        auto& config = attr.config;
+        auto readMiss = [](std::uint64_t cache) {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        switch (e) {
+            case PerfCounts::CYCLES:
+                type = PERF_TYPE_HARDWARE; config = PERF_COUNT_HW_CPU_CYCLES; break;
+            case PerfCounts::INSTRUCTIONS:
+                type = PERF_TYPE_HARDWARE; config = PERF_COUNT_HW_INSTRUCTIONS; break;
+            case PerfCounts::L1D_MISSES:
+                type = PERF_TYPE_HW_CACHE; config = readMiss(PERF_COUNT_HW_CACHE_L1D); break;
+            case PerfCounts::LLC_MISSES:
+                type = PERF_TYPE_HW_CACHE; config = readMiss(PERF_COUNT_HW_CACHE_LL); break;
+            case PerfCounts::DTLB_MISSES:
+                type = PERF_TYPE_HW_CACHE; config = readMiss(PERF_COUNT_HW_CACHE_DTLB); break;
+            default:
+                type = PERF_TYPE_HARDWARE; config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        }
+    }
+
+    int openEvent(PerfCounts::EVENT e, int groupFd) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        setEvent(e, attr);
+        attr.disabled = groupFd < 0 ? 1 : 0;    // the leader starts the group
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        // This thread, on any CPU.
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+    }
+}
+
+bool PerfCounters::open() {
+    close();
+
+    // Cycles lead if they can; otherwise the first event that opens does.
+    for (int e = 0; e < PerfCounts::NUM_EVENTS; e++) {
+        const int fd = openEvent(static_cast<PerfCounts::EVENT>(e), leader);
+        if (fd < 0) {
+            if (openError.empty())
+                openError = std::string("perf_event_open: ") + std::strerror(errno);
+            continue;
+        }
+        if (leader < 0)
+            leader = fd;
+        fds[e] = fd;
+        readOrder[e] = numOpen++;
+    }
+    if (leader < 0)
+        return false;
+
+    // A group that needs more counters than the PMU has never runs, so
+    // drop events from the end until it does.
+    while (numOpen > 1) {
+        start();
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        std::uint64_t buffer[3 + PerfCounts::NUM_EVENTS] = {};
+        if (::read(leader, buffer, sizeof(buffer)) > 0 && buffer[2] > 0)
+            break;
+        for (int e = PerfCounts::NUM_EVENTS - 1; e >= 0; e--) {
+            if (fds[e] >= 0 && fds[e] != leader) {
+                ::close(fds[e]);
+                fds[e] = -1;
+                numOpen--;
+                break;
+            }
+        }
+    }
+    openError.clear();
+    return true;
+}
+
+void PerfCounters::close() {
+    for (int& fd : fds) {
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+    leader = -1;
+    numOpen = 0;
+}
+
+void PerfCounters::start() {
+    if (leader < 0)
+        return;
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounts PerfCounters::stop() {
+    PerfCounts counts;
+    if (leader < 0)
+        return counts;
+    ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // nr, time_enabled, time_running, then one value per open event.
+    std::uint64_t buffer[3 + PerfCounts::NUM_EVENTS] = {};
+    const ssize_t expected = static_cast<ssize_t>((3 + numOpen) * sizeof(std::uint64_t));
+    if (::read(leader, buffer, sizeof(buffer)) != expected || buffer[2] == 0)
+        return counts;
+
+    const double scale = static_cast<double>(buffer[1]) / static_cast<double>(buffer[2]);
+    for (int e = 0; e < PerfCounts::NUM_EVENTS; e++) {
+        if (fds[e] < 0)
+            continue;
+        counts.valid[e] = true;
+        counts.value[e] = static_cast<std::uint64_t>(static_cast<double>(buffer[3 + readOrder[e]]) * scale);
+    }
+    return counts;
+}
+
+#else
+
+bool PerfCounters::open() {
+    openError = "hardware counters need Linux perf_event_open";
+    return false;
+}
+
+void PerfCounters::close() {
+}
+
+void PerfCounters::start() {
+}
+
+PerfCounts PerfCounters::stop() {
+    return {};
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef HASHTABLESOPENADDRESSING_PERFCOUNTERS_HPP
+#define HASHTABLESOPENADDRESSING_PERFCOUNTERS_HPP
+
+#include <string>
+#include <cstdint>
+
+// What the counters saw over one stretch of code. An event the machine
+// can't count stays invalid.
+struct PerfCounts {
+    enum EVENT {CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, DTLB_MISSES, BRANCH_MISSES, NUM_EVENTS};
+
+    bool valid[NUM_EVENTS] = {};
+    std::uint64_t value[NUM_EVENTS] = {};
+
+    // The CSV column name of each event, normalized per operation.
+    static const char* columnName( EVENT e );
+};
+
+// Hardware counters for the calling thread, through Linux perf_event_open.
+// The events are opened as one group, so they count over exactly the
+// same instructions; an event the CPU or the kernel won't give us is left
+// out of the group and reported invalid. Only user-space execution is
+// counted, which perf_event_paranoid allows up to level 2.
+//
+//     PerfCounters counters;
+//     if (counters.open()) {
+//         counters.start();
+//         ... measured code ...
+//         PerfCounts counts = counters.stop();
+//     }
+//
+// Elsewhere than Linux, open() always fails.
+class PerfCounters {
+
+public:
+    PerfCounters() = default;
+    ~PerfCounters();
+    PerfCounters( const PerfCounters& ) = delete;
+    PerfCounters& operator=( const PerfCounters& ) = delete;
+
+    // Returns false if no event could be opened; error() says why.
+    bool open();
+    void close();
+    [[nodiscard]] bool isOpen() const { return leader >= 0; }
+    [[nodiscard]] const std::string& error() const { return openError; }
+    [[nodiscard]] bool counts( PerfCounts::EVENT e ) const { return fds[e] >= 0; }
+
+    // Zero the counters and start them; stop them and read them. If the
+    // group never got onto the PMU in between, every event is invalid;
+    // if it was multiplexed with other groups, the counts are scaled up
+    // to the whole time.
+    void start();
+    PerfCounts stop();
+
+private:
+    int leader = -1;
+    int fds[PerfCounts::NUM_EVENTS] = {-1, -1, -1, -1, -1, -1};
+    int readOrder[PerfCounts::NUM_EVENTS] = {};     // position of each event in a group read
+    int numOpen = 0;
+    std::string openError;
+};
+
+
+#endif //HASHTABLESOPENADDRESSING_PERFCOUNTERS_HPP
@@ -8,6 +8,7 @@
 
 
 #include <string>
+#include <cstdint>
 struct RunMetaData {
 
     // dataset metadata
@@ -15,6 +16,8 @@ struct RunMetaData {
     int N   = 0;    // problem size for the trace (e.g., initial inserts)
     int seed = 0;   // RNG seed used to generate the trace
 
+    std::int64_t load_ns = 0;   // time to read the trace into memory
+
 };
 
 #endif //PRIORITY_QUEUE_STUDY_RUNPARAMS_HPP
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <sstream>
 
 #include "RunMetaData.hpp"
+#include "LatencyHistogram.hpp"
+#include "PerfCounters.hpp"
 
 struct RunResult {
     // identifiers
@@ -15,26 +17,59 @@ struct RunResult {
 
     // timing
     std::int64_t elapsed_ns = 0;   // total replay time (nanoseconds)
+    std::int64_t allocations = 0;  // heap allocations during the replay
+
+    // per-operation latencies (lru_harness --latency only)
+    LatencySummary insert_latency;
+    LatencySummary erase_latency;
+    LatencySummary lookup_latency;
+
+    // hardware counters over the median run (lru_harness --counters only)
+    PerfCounts counters;
 
     // operation counts
     long inserts     = 0;  // 'I'
     long erases      = 0;  // 'E'
+    long lookups     = 0;  // 'L'
 
     // convenience
     long total_ops() const {
-        return inserts + erases;
+        return inserts + erases + lookups;
     }
     double elapsed_ms() const {
         return static_cast<double>(elapsed_ns) / 1e6;
     }
+    double load_ms() const {
+        return static_cast<double>(run_meta_data.load_ns) / 1e6;
+    }
     double ops_per_sec() const {
         const double secs = static_cast<double>(elapsed_ns) / 1e9;
         return secs > 0.0 ? static_cast<double>(total_ops()) / secs : 0.0;
     }
+    double allocs_per_op() const {
+        return total_ops() > 0 ? static_cast<double>(allocations) / static_cast<double>(total_ops()) : 0.0;
+    }
 
     // CSV helpers
     static std::string csv_header() {
-        return "impl,profile,trace_path,N,seed,elapsed_ms,ops_total,inserts,erases";
+        return "impl,profile,trace_path,N,seed,elapsed_ms,load_ms,ops_total,inserts,erases,lookups,ops_per_sec,allocations,allocs_per_op,"
+            "insert_p50_ns,insert_p90_ns,insert_p99_ns,insert_p999_ns,insert_max_ns,"
+            "erase_p50_ns,erase_p90_ns,erase_p99_ns,erase_p999_ns,erase_max_ns,"
+            "lookup_p50_ns,lookup_p90_ns,lookup_p99_ns,lookup_p999_ns,lookup_max_ns,"
+            "cycles_per_op,instructions_per_op,l1d_misses_per_op,llc_misses_per_op,dtlb_misses_per_op,branch_misses_per_op";
+    }
+
+    // The five latency columns, left empty when nothing was timed.
+    static void latency_csv(std::ostream& os, const LatencySummary& s) {
+        if (!s.recorded) {
+            os << ",,,,,";
+            return;
+        }
+        os << ',' << s.p50
+           << ',' << s.p90
+           << ',' << s.p99
+           << ',' << s.p999
+           << ',' << s.max;
     }
 
     std::string to_short_csv_row() const {
@@ -55,9 +90,22 @@ struct RunResult {
            << run_meta_data.N << ','
            << run_meta_data.seed << ','
            << elapsed_ms() << ','
+           << load_ms() << ','
            << total_ops() << ','
            << inserts << ','
-           << erases;
+           << erases << ','
+           << lookups << ','
+           << static_cast<std::int64_t>(ops_per_sec()) << ','
+           << allocations << ','
+           << allocs_per_op();
+        latency_csv(os, insert_latency);
+        latency_csv(os, erase_latency);
+        latency_csv(os, lookup_latency);
+        for (int e = 0; e < PerfCounts::NUM_EVENTS; e++) {
+            os << ',';
+            if (counters.valid[e] && total_ops() > 0)
+                os << static_cast<double>(counters.value[e]) / static_cast<double>(total_ops());
+        }
         return os.str();
     }
 };
@@ -0,0 +1,288 @@
+#include "SwissTableDictionary.hpp"
+#include "HashTableDictionary.hpp"
+#include "KeyHash.hpp"
+#include "KeyStore.hpp"
+#include<iostream>
+#include<iomanip>
+#include<algorithm>
+#include<chrono>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    int lowestBit(std::uint32_t mask) {
+        return __builtin_ctz(mask);
+    }
+}
+
+std::size_t SwissTableDictionary::groupTableSize(std::size_t tableSize_) {
+    std::size_t size = GROUP_SIZE;
+    while (size < tableSize_)
+        size <<= 1;
+    return size;
+}
+
+SwissTableDictionary::SwissTableDictionary(std::size_t tableSize_, bool doCompact, double compactionFloor):
+    TABLE_SIZE{groupTableSize(tableSize_)}, groupMask{TABLE_SIZE / GROUP_SIZE - 1},
+    compactionTriggerEffectiveRate(compactionFloor), shouldCompact{doCompact} {
+    control.resize(TABLE_SIZE, CTRL_EMPTY);
+    slots.resize(TABLE_SIZE);
+}
+
+void SwissTableDictionary::clear() {
+    control.assign(TABLE_SIZE, CTRL_EMPTY);
+    slots.clear();
+    slots.resize(TABLE_SIZE);
+
+    numLookups = 0;
+    numDeletes = 0;
+    numInserts = 0;
+
+    numCompactions = 0;
+    numCompactionPauses = 0;
+    maxCompactionPauseNs = 0;
+
+    numFullScans = 0;
+    totalProbes = 0;
+    numStringCompares = 0;
+    numStringComparesAvoided = 0;
+
+    numberOfActive = 0;
+    numberOfTombstones = 0;
+
+    maxValuesInTable = 0;
+}
+
+std::uint64_t SwissTableDictionary::hashKey(std::string_view v) {
+    // Both the group index and the 7-bit control byte come from this one
+    // value, so all of its bits have to be well mixed.
+    return wyhash64(v);
+}
+
+std::uint32_t SwissTableDictionary::matchByte(std::size_t group, std::int8_t b) const {
+    const std::int8_t* ctrl = control.data() + group * GROUP_SIZE;
+#if defined(__SSE2__)
+    const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(b))));
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < GROUP_SIZE; i++)
+        if (ctrl[i] == b)
+            mask |= 1u << i;
+    return mask;
+#endif
+}
+
+std::uint32_t SwissTableDictionary::matchEmpty(std::size_t group) const {
+    return matchByte(group, CTRL_EMPTY);
+}
+
+std::uint32_t SwissTableDictionary::matchEmptyOrDeleted(std::size_t group) const {
+    // EMPTY and DELETED are the only control bytes with the sign bit set.
+    const std::int8_t* ctrl = control.data() + group * GROUP_SIZE;
+#if defined(__SSE2__)
+    const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(g));
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < GROUP_SIZE; i++)
+        if (ctrl[i] < 0)
+            mask |= 1u << i;
+    return mask;
+#endif
+}
+
+std::size_t SwissTableDictionary::findSlot(std::string_view v, std::uint64_t h) {
+    // Returns the slot that holds v, or TABLE_SIZE. A group with an EMPTY
+    // slot ends the search: v would have gone there.
+    const auto h2 = static_cast<std::int8_t>(h & 0x7F);
+    std::size_t group = (h >> 7) & groupMask;
+
+    for (std::size_t i = 0; i <= groupMask; i++) {
+        totalProbes++;
+        const std::uint32_t matches = matchByte(group, h2);
+        const std::uint32_t full = ~matchEmptyOrDeleted(group) & 0xFFFFu;
+        numStringComparesAvoided += __builtin_popcount(full) - __builtin_popcount(matches);
+        for (std::uint32_t m = matches; m != 0; m &= m - 1) {
+            const std::size_t idx = group * GROUP_SIZE + lowestBit(m);
+            numStringCompares++;
+            if (slots[idx] == v)
+                return idx;
+        }
+        if (matchEmpty(group) != 0)
+            return TABLE_SIZE;
+        group = (group + i + 1) & groupMask;
+    }
+    numFullScans++;
+    return TABLE_SIZE;
+}
+
+bool SwissTableDictionary::insert(std::string_view v) {
+    // Returns whether the insert was successful.
+
+    if (numberOfActive == static_cast<std::int64_t>(TABLE_SIZE)) {
+        std::cout << "Table is full. This is a serious problem. Terminating\n";
+        printStats();
+        exit(1);
+    }
+
+    const std::uint64_t h = hashKey(v);
+    if (findSlot(v, h) != TABLE_SIZE)
+        return false;
+
+    // The first EMPTY or DELETED slot on v's probe sequence. There is one,
+    // since the table isn't full.
+    std::size_t group = (h >> 7) & groupMask;
+    std::uint32_t m;
+    for (std::size_t i = 0; (m = matchEmptyOrDeleted(group)) == 0; i++)
+        group = (group + i + 1) & groupMask;
+
+    const std::size_t idx = group * GROUP_SIZE + lowestBit(m);
+    if (control[idx] == CTRL_DELETED)
+        numberOfTombstones--;
+    control[idx] = static_cast<std::int8_t>(h & 0x7F);
+    slots[idx] = v;
+    numberOfActive++;
+    numInserts++;
+
+    if (maxValuesInTable < numberOfActive)
+        maxValuesInTable = numberOfActive;
+
+    if (shouldCompact && static_cast<double>(numberOfActive + numberOfTombstones) >
+                         compactionTriggerEffectiveRate * static_cast<double>(TABLE_SIZE)) {
+        auto t0 = std::chrono::steady_clock::now();
+        compactTable();
+        auto t1 = std::chrono::steady_clock::now();
+        const std::int64_t pauseNs = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        numCompactionPauses++;
+        maxCompactionPauseNs = std::max(maxCompactionPauseNs, pauseNs);
+        numCompactions++;
+    }
+
+    return true;
+}
+
+bool SwissTableDictionary::member(std::string_view v) {
+    numLookups++;
+    return findSlot(v, hashKey(v)) != TABLE_SIZE;
+}
+
+bool SwissTableDictionary::remove(std::string_view v) {
+    const std::size_t idx = findSlot(v, hashKey(v));
+    if (idx == TABLE_SIZE)
+        return false;
+
+    // A group that still has an EMPTY slot has never been full, so no probe
+    // sequence has ever gone past it and the slot can simply become EMPTY.
+    if (matchEmpty(idx / GROUP_SIZE) != 0) {
+        control[idx] = CTRL_EMPTY;
+    } else {
+        control[idx] = CTRL_DELETED;
+        numberOfTombstones++;
+    }
+    numberOfActive--;
+    numDeletes++;
+
+    return true;
+}
+
+void SwissTableDictionary::compactTable() {
+    // Rehash every live key into fresh arrays of the same size.
+    std::vector<std::int8_t> oldControl(TABLE_SIZE, CTRL_EMPTY);
+    std::vector<std::string> oldSlots(TABLE_SIZE);
+    control.swap(oldControl);
+    slots.swap(oldSlots);
+    numberOfTombstones = 0;
+
+    for (std::size_t i = 0; i < TABLE_SIZE; i++) {
+        if (oldControl[i] < 0)
+            continue;
+
+        const std::uint64_t h = hashKey(oldSlots[i]);
+        std::size_t group = (h >> 7) & groupMask;
+        std::uint32_t m;
+        for (std::size_t j = 0; (m = matchEmpty(group)) == 0; j++)
+            group = (group + j + 1) & groupMask;
+
+        const std::size_t idx = group * GROUP_SIZE + lowestBit(m);
+        control[idx] = oldControl[i];
+        slots[idx] = std::move(oldSlots[i]);
+    }
+}
+
+bool SwissTableDictionary::empty() const {
+    return numberOfActive == 0;
+}
+
+std::size_t SwissTableDictionary::size() const {
+    return numberOfActive;
+}
+
+std::string SwissTableDictionary::csvStatsHeader() {
+    return HashTableDictionary::csvStatsHeader();
+}
+
+std::string SwissTableDictionary::csvStats() {
+    // Same columns as HashTableDictionary::csvStats(); a probe is one group.
+    const auto size = static_cast<double>(TABLE_SIZE);
+    const std::int64_t available = static_cast<std::int64_t>(TABLE_SIZE) - numberOfTombstones - numberOfActive;
+    return std::to_string(TABLE_SIZE) + "," + // table size
+           std::to_string(numberOfActive) + "," + // active
+           std::to_string(available) + "," + // available
+           std::to_string(numberOfTombstones) + "," + // tombstones
+           std::to_string(totalProbes) + "," + // totalProbes
+           std::to_string(numInserts) + "," + // inserts
+           std::to_string(numDeletes) + "," + // deletes
+           std::to_string(numLookups) + "," + // lookups
+           std::to_string(numFullScans) + "," + // full scans
+           std::to_string(numCompactions) + "," + // compactions
+           std::to_string(maxValuesInTable) + "," + // max_in_table
+           std::to_string(static_cast<int>(static_cast<double>(available) / size * 100)) + "," + // ratio available
+           std::to_string(static_cast<int>(static_cast<double>(numberOfActive) / size * 100)) + "," + // load factor
+           std::to_string(static_cast<int>(static_cast<double>(numberOfActive + numberOfTombstones) / size * 100)) +
+           "," + // effective load factor
+           std::to_string(static_cast<int>(static_cast<double>(numberOfTombstones) / size * 100)) + "," + // ratio tombstones
+           std::to_string(static_cast<double>(totalProbes) / static_cast<double>(numInserts + numDeletes + numLookups)) +
+#if defined(__SSE2__)
+           ",swiss_sse2," +
+#else
+           ",swiss_scalar," +
+#endif
+           (shouldCompact ? "compaction_on" : "compaction_off") +
+           ",rebuild," +
+           std::to_string(numCompactionPauses) + "," + // compaction pauses
+           std::to_string(static_cast<double>(maxCompactionPauseNs) / 1e3) + "," + // longest pause
+           "0,tombstone," + // keys are never shifted
+           std::to_string(numStringComparesAvoided) + // full slots the control bytes ruled out
+           ",wyhash,strings," +
+           std::to_string(static_cast<double>(KeyStore::bytesUsed(slots)) /
+                          static_cast<double>(std::max<std::int64_t>(numberOfActive, 1))) + // key bytes per live key
+           ",0" + // never resized
+           ",,,,,,,,,,,,,"; // probe lengths and clusters: a probe visits groups, not runs of slots
+}
+
+void SwissTableDictionary::printStats() const {
+
+    const int width = 8;
+    std::cout << std::setw(width) << TABLE_SIZE << " table size (" << groupMask + 1 << " groups of "
+              << GROUP_SIZE << ")." << std::endl;
+    std::cout << std::setw(width) << numberOfTombstones << " cells marked as deleted."  << std::endl;
+    std::cout << std::setw(width) << numberOfActive << " active cells."  << std::endl;
+    std::cout << std::setw(width) << maxValuesInTable << " maximum number of values in the table ever." << std::endl;
+    std::cout << std::setw(width) << totalProbes << " groups probed." << std::endl;
+    std::cout << std::setw(width) << numStringCompares << " string compares." << std::endl;
+    std::cout << std::setw(width) << numStringComparesAvoided << " string compares avoided by control bytes." << std::endl;
+
+    std::cout << std::endl;
+    std::cout << std::setw(width) << numInserts << " inserts."  << std::endl;
+    std::cout << std::setw(width) << numDeletes << " deletes."  << std::endl;
+    std::cout << std::setw(width) << numLookups << " lookups."  << std::endl;
+    std::cout << std::setw(width) << numFullScans << " full scans."  << std::endl;
+    std::cout << std::setw(width) << numCompactions << " compactions."  << std::endl;
+    std::cout << std::endl;
+
+    std::cout << static_cast<double>(totalProbes) / static_cast<double>(numInserts + numDeletes + numLookups) <<
+        " average number of groups probed (" << (shouldCompact ? "compaction on)." : "compaction off).") << std::endl;
+}
@@ -0,0 +1,89 @@
+#ifndef HASHTABLESOPENADDRESSING_SWISSTABLEDICTIONARY_HPP
+#define HASHTABLESOPENADDRESSING_SWISSTABLEDICTIONARY_HPP
+
+#include<vector>
+#include<string>
+#include<string_view>
+#include <cstdint>
+
+// An open-addressed string set laid out like Abseil's "Swiss tables".
+// Next to the key slots there is a dense array of one-byte control words.
+// A control word says the slot is EMPTY or DELETED or, for a used slot,
+// holds 7 bits of the key's hash. Slots are probed a group of 16 at a time:
+// one SSE2 compare finds every slot in the group whose control byte matches
+// the key's 7 bits, and only those slots get a string compare. Groups are
+// visited in triangular order, which reaches every group because the number
+// of groups is a power of two.
+//
+// The interface mirrors HashTableDictionary so that lru_harness can replay
+// the same traces through it, and csvStats() fills the same columns.
+
+class SwissTableDictionary {
+
+public:
+    // tableSize_ is rounded up to a power of two of at least one group.
+    explicit SwissTableDictionary( std::size_t tableSize_,
+        bool doCompact=true, double compactionTriggerRate=0.875 );
+
+    bool insert( std::string_view v );
+    bool member( std::string_view v );
+    bool remove( std::string_view v );
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] std::size_t size() const;
+    void printStats() const;
+
+    void clear();
+    std::string csvStats();
+    static std::string csvStatsHeader();
+
+    static constexpr std::size_t GROUP_SIZE = 16;
+
+    // The number of slots a table built with tableSize_ has. For the
+    // prime sizes of tableSizeForCapacity() it is up to twice as many,
+    // so a Swiss table holds N keys at a lower load factor.
+    static std::size_t groupTableSize( std::size_t tableSize_ );
+
+private:
+    // Used slots hold the low 7 bits of the hash (0..127); both special
+    // values have the sign bit set.
+    static constexpr std::int8_t CTRL_EMPTY = -128;
+    static constexpr std::int8_t CTRL_DELETED = -2;
+
+    std::size_t TABLE_SIZE;
+    std::size_t groupMask;          // number of groups - 1
+
+    std::vector<std::int8_t> control;
+    std::vector<std::string> slots;
+
+    static std::uint64_t hashKey( std::string_view v );
+    [[nodiscard]] std::uint32_t matchByte( std::size_t group, std::int8_t b ) const;
+    [[nodiscard]] std::uint32_t matchEmpty( std::size_t group ) const;
+    [[nodiscard]] std::uint32_t matchEmptyOrDeleted( std::size_t group ) const;
+
+    std::size_t findSlot( std::string_view v, std::uint64_t h );
+    void compactTable();
+
+    double compactionTriggerEffectiveRate = 0.875;
+    bool shouldCompact = true;
+
+    std::int64_t numLookups = 0;
+    std::int64_t numDeletes = 0;
+    std::int64_t numInserts = 0;
+
+    int numCompactions = 0;
+    std::int64_t numCompactionPauses = 0;
+    std::int64_t maxCompactionPauseNs = 0;
+
+    std::int64_t numFullScans = 0;
+    std::int64_t totalProbes = 0;           // groups visited
+    std::int64_t numStringCompares = 0;
+    std::int64_t numStringComparesAvoided = 0;  // full slots whose control byte didn't match
+
+    std::int64_t numberOfActive = 0;
+    std::int64_t numberOfTombstones = 0;
+
+    std::int64_t maxValuesInTable = 0;
+};
+
+
+#endif //HASHTABLESOPENADDRESSING_SWISSTABLEDICTIONARY_HPP
@@ -12,12 +12,17 @@
 
 struct TraceConfig {
 
+    // How lru_tracegen picks the keys it accesses. LRU_BAG is the original
+    // profile: every key appears a fixed number of times, shuffled.
+    enum ACCESS_PATTERN {LRU_BAG, ZIPFIAN, SHIFTING_HOT_SET, SCAN_BURSTS};
+
     explicit TraceConfig(const std::string &pName):profileName(pName) {
         // Generates N = 2^10, 2^11, ..., 2^20
         constexpr int start_exp = 10, end_exp = 20;
         for (int exp = start_exp; exp <= end_exp; exp++)
             Ns.push_back(1 << exp);
 
+        setProfile(pName);
     }
 
     std::vector<unsigned> seeds = {23};  // only one seed to get started.
@@ -25,6 +30,60 @@ struct TraceConfig {
     std::string traceDirectory = "traceFiles"; // awkward!
     std::string profileName;
 
+    // Every profile draws 12N accesses from the first 4N words of the word
+    // list, for a cache of N keys.
+    ACCESS_PATTERN pattern = LRU_BAG;
+    std::size_t accessesPerN = 12;
+    std::size_t keysPerN = 4;
+
+    // The fraction of the accesses that are reads. A read is an L line; if
+    // it misses, the key is fetched and inserted as a write would be. The
+    // rest are writes, I lines, as in the original profile.
+    double readFraction = 0.0;
+
+    // ZIPFIAN and SCAN_BURSTS: the k-th most popular key is accessed with
+    // probability proportional to 1 / k^zipfSkew.
+    double zipfSkew = 0.99;
+
+    // SHIFTING_HOT_SET: hotAccessFraction of the accesses go to a hot set
+    // of hotSetFraction * N keys, the rest to any key; every
+    // hotSetLifetime * N accesses the hot set moves to other keys.
+    double hotSetFraction = 0.5;
+    double hotAccessFraction = 0.9;
+    double hotSetLifetime = 1.0;
+
+    // SCAN_BURSTS: every scanEvery * N accesses, a scan reads
+    // scanLength * N consecutive keys once each.
+    double scanEvery = 2.0;
+    double scanLength = 0.5;
+
+    // The profiles lru_tracegen knows, with their defaults; the production
+    // mixes are 90% reads. Returns false for any other name, and leaves
+    // the settings alone.
+    static std::vector<std::string> profileNames() {
+        return {"lru_profile", "zipf_profile", "hotset_profile", "scan_profile"};
+    }
+
+    bool setProfile(const std::string &pName) {
+        if (pName == "lru_profile") {
+            pattern = LRU_BAG;
+            readFraction = 0.0;
+        } else if (pName == "zipf_profile") {
+            pattern = ZIPFIAN;
+            readFraction = 0.9;
+        } else if (pName == "hotset_profile") {
+            pattern = SHIFTING_HOT_SET;
+            readFraction = 0.9;
+        } else if (pName == "scan_profile") {
+            pattern = SCAN_BURSTS;
+            readFraction = 0.9;
+        } else {
+            return false;
+        }
+        profileName = pName;
+        return true;
+    }
+
     std::string makeTraceFileName(const unsigned int seed, const unsigned n) {
         assert(profileName != "");
         return traceDirectory + "/" +
@@ -0,0 +1,271 @@
+#include "TraceFiles.hpp"
+#include<fstream>
+#include<sstream>
+#include<unordered_map>
+#include<cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char BINARY_TRACE_MAGIC[8] = {'L', 'R', 'U', 'B', 'T', 'R', 'C', '\0'};
+
+    std::uint64_t paddedTo8(std::uint64_t n) {
+        return (n + 7) & ~std::uint64_t{7};
+    }
+
+    void writePadding(std::ofstream& out, std::uint64_t n) {
+        const char zeros[8] = {};
+        out.write(zeros, static_cast<std::streamsize>(paddedTo8(n) - n));
+    }
+}
+
+// ================================================================
+// Parse trace: header "<profile> <N> <seed>"
+// Then lines: I key   or   E key   or   L key
+// ================================================================
+bool load_trace_strict_header(const std::string& path,
+    RunMetaData& runMeta,
+    std::vector<Operation>& out_operations)
+{
+    out_operations.clear();
+
+    std::ifstream in(path);
+    if (!in.is_open())
+        return false;
+
+    // Header
+    std::string header;
+    if (!std::getline(in, header))
+        return false;
+
+    std::istringstream hdr(header);
+    if (!(hdr >> runMeta.profile >> runMeta.N >> runMeta.seed))
+        return false;
+
+    // Opcodes
+    std::string line;
+    while (std::getline(in, line)) {
+
+        const auto first = line.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+
+        std::istringstream iss(line.substr(first));
+        std::string tok, key;
+
+        if (!(iss >> tok))
+            continue;
+
+        if (!(iss >> key))
+            return false;
+
+        if (tok == "I") {
+            out_operations.emplace_back(OpCode::Insert, key);
+        }
+        else if (tok == "E") {
+            out_operations.emplace_back(OpCode::Erase, key);
+        }
+        else if (tok == "L") {
+            out_operations.emplace_back(OpCode::Lookup, key);
+        }
+        else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string binary_trace_path(const std::string& textPath)
+{
+    const std::string suffix = ".trace";
+    if (textPath.size() >= suffix.size() &&
+        textPath.compare(textPath.size() - suffix.size(), suffix.size(), suffix) == 0)
+        return textPath.substr(0, textPath.size() - suffix.size()) + ".btrace";
+    return textPath + ".btrace";
+}
+
+// ================================================================
+// write_binary_trace: number the distinct keys in order of first use,
+// then write the header, the key dictionary and the op stream
+// ================================================================
+bool write_binary_trace(const std::string& path,
+    const RunMetaData& runMeta,
+    const std::vector<Operation>& operations)
+{
+    std::unordered_map<std::string_view, std::uint32_t> keyIds;
+    std::vector<std::string_view> keys;
+    std::vector<std::uint32_t> ops;
+    ops.reserve(operations.size());
+    std::uint64_t keyBytes = 0;
+
+    for (const auto& op : operations) {
+        auto [it, added] = keyIds.try_emplace(op.key, static_cast<std::uint32_t>(keys.size()));
+        if (added) {
+            if (keys.size() == BinaryTraceHeader::L_BIT)
+                return false;
+            keys.push_back(op.key);
+            keyBytes += op.key.size();
+        }
+        ops.push_back(it->second |
+            (op.tag == OpCode::Erase ? BinaryTraceHeader::E_BIT :
+             op.tag == OpCode::Lookup ? BinaryTraceHeader::L_BIT : 0));
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+
+    BinaryTraceHeader header{};
+    std::memcpy(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic));
+    header.version = BinaryTraceHeader::VERSION;
+    header.profileLength = static_cast<std::uint32_t>(runMeta.profile.size());
+    header.N = runMeta.N;
+    header.seed = runMeta.seed;
+    header.numKeys = keys.size();
+    header.numOps = ops.size();
+    header.keyBytes = keyBytes;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    out.write(runMeta.profile.data(), static_cast<std::streamsize>(runMeta.profile.size()));
+    writePadding(out, runMeta.profile.size());
+
+    std::uint64_t offset = 0;
+    for (const auto& key : keys) {
+        out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+        offset += key.size();
+    }
+    out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+
+    for (const auto& key : keys)
+        out.write(key.data(), static_cast<std::streamsize>(key.size()));
+    writePadding(out, keyBytes);
+
+    out.write(reinterpret_cast<const char*>(ops.data()),
+        static_cast<std::streamsize>(ops.size() * sizeof(std::uint32_t)));
+
+    return static_cast<bool>(out);
+}
+
+// ================================================================
+// MappedTrace
+// ================================================================
+MappedTrace::~MappedTrace() {
+    close();
+}
+
+void MappedTrace::close() {
+    if (base != nullptr)
+        munmap(base, length);
+    base = nullptr;
+    length = 0;
+    offsets = nullptr;
+    keyBytes = nullptr;
+    ops = nullptr;
+    lookupBit = 0;
+    keyCount = 0;
+    opCount = 0;
+}
+
+bool MappedTrace::open(const std::string& path, RunMetaData& runMeta, std::vector<OperationView>& out_operations) {
+    out_operations.clear();
+    if (!map(path, runMeta))
+        return false;
+    out_operations.reserve(opCount);
+    if (!appendOps(0, opCount, out_operations)) {
+        out_operations.clear();
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool MappedTrace::map(const std::string& path, RunMetaData& runMeta) {
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(BinaryTraceHeader)) {
+        ::close(fd);
+        return false;
+    }
+    length = static_cast<std::size_t>(st.st_size);
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);                    // the mapping keeps the file open
+    if (mapping == MAP_FAILED) {
+        length = 0;
+        return false;
+    }
+    base = mapping;
+    madvise(base, length, MADV_SEQUENTIAL);
+
+    // Every section has to fit in the file; the sizes come from the file,
+    // so each is checked before it is added.
+    const char* bytes = static_cast<const char*>(base);
+    BinaryTraceHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    const bool version1 = header.version == 1;
+    if (std::memcmp(header.magic, BINARY_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        (header.version != BinaryTraceHeader::VERSION && !version1) ||
+        header.numKeys >= (version1 ? BinaryTraceHeader::E_BIT : BinaryTraceHeader::L_BIT)) {
+        close();
+        return false;
+    }
+    std::uint64_t pos = sizeof(header);
+    const std::uint64_t profileAt = pos;
+    pos += paddedTo8(header.profileLength);
+    const std::uint64_t offsetsAt = pos;
+    if (pos > length || (length - pos) / sizeof(std::uint64_t) < header.numKeys + 1) {
+        close();
+        return false;
+    }
+    pos += (header.numKeys + 1) * sizeof(std::uint64_t);
+    const std::uint64_t keysAt = pos;
+    if (length - pos < header.keyBytes) {
+        close();
+        return false;
+    }
+    pos += paddedTo8(header.keyBytes);
+    const std::uint64_t opsAt = pos;
+    if (pos > length || (length - pos) / sizeof(std::uint32_t) < header.numOps) {
+        close();
+        return false;
+    }
+
+    // The sections are 8-byte aligned in the file, and so in the mapping.
+    offsets = reinterpret_cast<const std::uint64_t*>(bytes + offsetsAt);
+    for (std::uint64_t i = 0; i < header.numKeys; i++) {
+        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > header.keyBytes) {
+            close();
+            return false;
+        }
+    }
+    keyBytes = bytes + keysAt;
+    ops = reinterpret_cast<const std::uint32_t*>(bytes + opsAt);
+    lookupBit = version1 ? 0 : BinaryTraceHeader::L_BIT;
+    keyCount = header.numKeys;
+    opCount = header.numOps;
+
+    runMeta.profile.assign(bytes + profileAt, header.profileLength);
+    runMeta.N = header.N;
+    runMeta.seed = header.seed;
+    return true;
+}
+
+bool MappedTrace::appendOps(std::size_t from, std::size_t to, std::vector<OperationView>& out_operations) const {
+    for (std::size_t i = from; i < to && i < opCount; i++) {
+        const std::uint32_t id = ops[i] & ~(BinaryTraceHeader::E_BIT | lookupBit);
+        if (id >= keyCount || ((ops[i] & BinaryTraceHeader::E_BIT) && (ops[i] & lookupBit)))
+            return false;
+        const OpCode tag = (ops[i] & BinaryTraceHeader::E_BIT) ? OpCode::Erase :
+            (ops[i] & lookupBit) ? OpCode::Lookup : OpCode::Insert;
+        out_operations.emplace_back(tag,
+            std::string_view(keyBytes + offsets[id], offsets[id + 1] - offsets[id]));
+    }
+    return true;
+}
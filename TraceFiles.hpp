@@ -0,0 +1,98 @@
+#ifndef HASHTABLESOPENADDRESSING_TRACEFILES_HPP
+#define HASHTABLESOPENADDRESSING_TRACEFILES_HPP
+
+#include<vector>
+#include<string>
+#include<string_view>
+#include <cstdint>
+
+#include "Operations.hpp"
+#include "RunMetaData.hpp"
+
+// Reading and writing traces.
+//
+// A text trace (.trace) is the header line "<profile> <N> <seed>" and then
+// one "I key", "E key" or "L key" line per operation.
+//
+// A binary trace (.btrace) holds the same operations with every distinct
+// key stored once. Integers are in the byte order of the machine that
+// wrote the file; a file from the other byte order fails the version check.
+//
+//   header    BinaryTraceHeader
+//   profile   the profile name, padded to a multiple of 8 bytes
+//   offsets   numKeys + 1 uint64s: key i is keys[offsets[i], offsets[i+1])
+//   keys      the distinct keys back to back, padded to a multiple of 8 bytes
+//   ops       one uint32 per operation: the key's id, with E_BIT set for an
+//             E and L_BIT for an L
+//
+// Version 1 files, written before there were L lines, have no L_BIT, and
+// their key ids may use it; they still load.
+//
+// MappedTrace maps the file read-only, and the keys of its operations point
+// straight into the mapping.
+
+struct BinaryTraceHeader {
+    char magic[8];                  // "LRUBTRC\0"
+    std::uint32_t version;
+    std::uint32_t profileLength;
+    std::int32_t N;
+    std::int32_t seed;
+    std::uint64_t numKeys;
+    std::uint64_t numOps;
+    std::uint64_t keyBytes;
+
+    static constexpr std::uint32_t VERSION = 2;
+    static constexpr std::uint32_t E_BIT = 0x80000000u;
+    static constexpr std::uint32_t L_BIT = 0x40000000u;
+};
+
+// Parses a text trace. Returns false if the file can't be read or a line
+// is malformed.
+bool load_trace_strict_header(const std::string& path,
+    RunMetaData& runMeta,
+    std::vector<Operation>& out_operations);
+
+// Writes the operations as a binary trace. Returns false if the file can't
+// be written or there are 2^30 distinct keys or more.
+bool write_binary_trace(const std::string& path,
+    const RunMetaData& runMeta,
+    const std::vector<Operation>& operations);
+
+// The path of the binary trace that goes with a text trace: "x.trace"
+// becomes "x.btrace".
+std::string binary_trace_path(const std::string& textPath);
+
+class MappedTrace {
+
+public:
+    MappedTrace() = default;
+    ~MappedTrace();
+    MappedTrace( const MappedTrace& ) = delete;
+    MappedTrace& operator=( const MappedTrace& ) = delete;
+
+    // Maps a binary trace and fills in its metadata and its operations,
+    // whose keys stay valid until the trace is closed or destroyed. Returns
+    // false if the file can't be mapped or is not a well-formed trace.
+    bool open( const std::string& path, RunMetaData& runMeta, std::vector<OperationView>& out_operations );
+    // open() in two steps, for readers that want the operations a stretch
+    // at a time (see TraceStream). map() checks everything but the key ids;
+    // appendOps() checks those of operations [from, to) as it appends them.
+    bool map( const std::string& path, RunMetaData& runMeta );
+    bool appendOps( std::size_t from, std::size_t to, std::vector<OperationView>& out_operations ) const;
+    [[nodiscard]] std::size_t numOps() const { return opCount; }
+    void close();
+
+private:
+    void* base = nullptr;
+    std::size_t length = 0;
+
+    const std::uint64_t* offsets = nullptr;
+    const char* keyBytes = nullptr;
+    const std::uint32_t* ops = nullptr;
+    std::uint32_t lookupBit = 0;        // L_BIT, or 0 in a version 1 file
+    std::size_t keyCount = 0;
+    std::size_t opCount = 0;
+};
+
+
+#endif //HASHTABLESOPENADDRESSING_TRACEFILES_HPP
@@ -0,0 +1,240 @@
+#include "TraceStream.hpp"
+#include<sstream>
+#include<chrono>
+#include<cstring>
+#include<algorithm>
+
+namespace {
+    std::int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool endsWith(const std::string& s, const std::string& suffix) {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+}
+
+TraceStream::~TraceStream() {
+    finish();
+}
+
+bool TraceStream::start(const std::string& path, RunMetaData& runMeta) {
+    finish();
+
+    numFull = 0;
+    fillIdx = 0;
+    takeIdx = 0;
+    holding = false;
+    stopping = false;
+    ended = false;
+    parseFailed = false;
+    loaderBusyNs = 0;
+    consumerStallNs = 0;
+    numInserts = 0;
+    numErases = 0;
+    numLookups = 0;
+
+    binary = endsWith(path, ".btrace");
+    if (binary) {
+        if (!mapped.map(path, runMeta))
+            return false;
+    } else {
+        mapped.close();
+        text.close();
+        text.clear();
+        text.open(path, std::ios::binary);
+        if (!text.is_open())
+            return false;
+        chunk.resize(CHUNK_BYTES);
+        chunkPos = chunkEnd = 0;
+
+        // Header: "<profile> <N> <seed>"
+        std::string_view line;
+        if (!nextLine(line))
+            return false;
+        std::istringstream hdr{std::string(line)};
+        if (!(hdr >> runMeta.profile >> runMeta.N >> runMeta.seed))
+            return false;
+    }
+
+    loader = std::thread(&TraceStream::load, this);
+    return true;
+}
+
+void TraceStream::finish() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    blockFree.notify_all();
+    if (loader.joinable())
+        loader.join();
+}
+
+const std::vector<OperationView>* TraceStream::next() {
+    std::unique_lock<std::mutex> guard(lock);
+    if (holding) {
+        holding = false;
+        blockFree.notify_one();
+    }
+    if (ended)
+        return nullptr;
+
+    if (numFull == 0) {
+        const std::int64_t t0 = nowNs();
+        blockFull.wait(guard, [this] { return numFull > 0; });
+        consumerStallNs += nowNs() - t0;
+    }
+    Block& block = blocks[takeIdx];
+    takeIdx = (takeIdx + 1) % NUM_BLOCKS;
+    numFull--;
+    ended = block.last;
+    if (block.ops.empty()) {
+        blockFree.notify_one();
+        return nullptr;
+    }
+    holding = true;
+    return &block.ops;
+}
+
+void TraceStream::load() {
+    // The caller's block is the one before takeIdx and the full ones run
+    // from takeIdx to fillIdx, so fillIdx is free while fewer than
+    // NUM_BLOCKS are either.
+    std::size_t nextOp = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            blockFree.wait(guard, [this] { return stopping || numFull + (holding ? 1 : 0) < NUM_BLOCKS; });
+            if (stopping)
+                return;
+        }
+        Block& block = blocks[fillIdx];
+
+        const std::int64_t t0 = nowNs();
+        const bool ok = binary ? fillFromBinary(block, nextOp) : fillFromText(block);
+        if (!ok) {
+            block.ops.clear();
+            block.last = true;
+            parseFailed = true;
+        }
+        for (const auto& op : block.ops) {
+            if (op.tag == OpCode::Insert) ++numInserts;
+            else if (op.tag == OpCode::Erase) ++numErases;
+            else ++numLookups;
+        }
+        loaderBusyNs += nowNs() - t0;
+
+        const bool last = block.last;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            fillIdx = (fillIdx + 1) % NUM_BLOCKS;
+            numFull++;
+        }
+        blockFull.notify_one();
+        if (last)
+            return;
+    }
+}
+
+bool TraceStream::fillFromBinary(Block& block, std::size_t& nextOp) {
+    block.ops.clear();
+    const std::size_t to = std::min(nextOp + BLOCK_OPS, mapped.numOps());
+    if (!mapped.appendOps(nextOp, to, block.ops))
+        return false;
+    nextOp = to;
+    block.last = nextOp == mapped.numOps();
+    return true;
+}
+
+bool TraceStream::fillFromText(Block& block) {
+    // Lines are parsed in place: the tag, then the key, each a run of
+    // non-blank characters; anything after the key is ignored, as in
+    // load_trace_strict_header().
+    block.ops.clear();
+    block.keyBytes.clear();
+    block.keyEnds.clear();
+    block.tags.clear();
+    block.last = false;
+
+    std::string_view line;
+    while (block.tags.size() < BLOCK_OPS) {
+        if (!nextLine(line)) {
+            block.last = true;
+            break;
+        }
+        std::size_t i = 0;
+        while (i < line.size() && isSpace(line[i]))
+            i++;
+        if (i == line.size() || line[i] == '#')
+            continue;
+        const std::size_t tagStart = i;
+        while (i < line.size() && !isSpace(line[i]))
+            i++;
+        const std::string_view tag = line.substr(tagStart, i - tagStart);
+        while (i < line.size() && isSpace(line[i]))
+            i++;
+        const std::size_t keyStart = i;
+        while (i < line.size() && !isSpace(line[i]))
+            i++;
+        if (i == keyStart)
+            return false;
+
+        if (tag == "I")
+            block.tags.push_back(OpCode::Insert);
+        else if (tag == "E")
+            block.tags.push_back(OpCode::Erase);
+        else if (tag == "L")
+            block.tags.push_back(OpCode::Lookup);
+        else
+            return false;
+        block.keyBytes.insert(block.keyBytes.end(), line.data() + keyStart, line.data() + i);
+        block.keyEnds.push_back(static_cast<std::uint32_t>(block.keyBytes.size()));
+    }
+
+    // keyBytes has stopped moving, so the views can point into it.
+    std::uint32_t keyStart = 0;
+    for (std::size_t k = 0; k < block.tags.size(); k++) {
+        block.ops.emplace_back(block.tags[k],
+            std::string_view(block.keyBytes.data() + keyStart, block.keyEnds[k] - keyStart));
+        keyStart = block.keyEnds[k];
+    }
+    return true;
+}
+
+bool TraceStream::nextLine(std::string_view& line) {
+    // The next line of the text, without its '\n'. It stays valid until
+    // the next call. A line longer than the chunk grows the chunk.
+    for (;;) {
+        const char* begin = chunk.data() + chunkPos;
+        const auto* newline = static_cast<const char*>(std::memchr(begin, '\n', chunkEnd - chunkPos));
+        if (newline != nullptr) {
+            line = std::string_view(begin, static_cast<std::size_t>(newline - begin));
+            chunkPos += line.size() + 1;
+            return true;
+        }
+        if (!text) {
+            // The end of the file: what is left is the last line.
+            if (chunkPos == chunkEnd)
+                return false;
+            line = std::string_view(begin, chunkEnd - chunkPos);
+            chunkPos = chunkEnd;
+            return true;
+        }
+
+        // Keep the partial line and read more after it.
+        const std::size_t partial = chunkEnd - chunkPos;
+        std::memmove(chunk.data(), begin, partial);
+        chunkPos = 0;
+        chunkEnd = partial;
+        if (chunkEnd == chunk.size())
+            chunk.resize(2 * chunk.size());
+        text.read(chunk.data() + chunkEnd, static_cast<std::streamsize>(chunk.size() - chunkEnd));
+        chunkEnd += static_cast<std::size_t>(text.gcount());
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef HASHTABLESOPENADDRESSING_TRACESTREAM_HPP
+#define HASHTABLESOPENADDRESSING_TRACESTREAM_HPP
+
+#include<vector>
+#include<string>
+#include<string_view>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<fstream>
+#include <cstdint>
+
+#include "Operations.hpp"
+#include "RunMetaData.hpp"
+#include "TraceFiles.hpp"
+
+// Reads a trace a block of operations at a time, on a loader thread, while
+// the caller replays the blocks before it. Memory stays at NUM_BLOCKS
+// blocks however long the trace is.
+//
+// The blocks form a ring. The loader fills the free blocks in order and
+// hands them over; next() gives the caller the oldest full one, and takes
+// back the one it gave before. A text trace is read CHUNK_BYTES at a time
+// and its keys are copied into the block; a binary trace (see
+// TraceFiles.hpp) is mapped, and the keys point into the mapping.
+//
+//     TraceStream stream;
+//     stream.start(path, meta);
+//     while (const auto* ops = stream.next())
+//         ... replay *ops ...
+//     stream.finish();
+//     if (stream.failed()) ...
+
+class TraceStream {
+
+public:
+    static constexpr std::size_t BLOCK_OPS = 1 << 16;
+    static constexpr std::size_t NUM_BLOCKS = 4;
+    static constexpr std::size_t CHUNK_BYTES = 1 << 20;
+
+    TraceStream() = default;
+    ~TraceStream();
+    TraceStream( const TraceStream& ) = delete;
+    TraceStream& operator=( const TraceStream& ) = delete;
+
+    // Opens a .trace or .btrace file, reads its header into runMeta and
+    // starts the loader. Returns false if the file can't be opened or its
+    // header is bad. A stream can be started again once it has finished.
+    bool start( const std::string& path, RunMetaData& runMeta );
+    // The next block, or nullptr at the end of the trace or on a parse
+    // error. The block stays valid until the next call.
+    const std::vector<OperationView>* next();
+    // Stops the loader early (if it is still running) and joins it.
+    void finish();
+
+    // Read these after finish(). The times are since start(): what the
+    // loader spent reading and parsing, and what next() spent waiting.
+    [[nodiscard]] bool failed() const { return parseFailed; }
+    [[nodiscard]] std::int64_t loaderNs() const { return loaderBusyNs; }
+    [[nodiscard]] std::int64_t stallNs() const { return consumerStallNs; }
+    [[nodiscard]] long inserts() const { return numInserts; }
+    [[nodiscard]] long erases() const { return numErases; }
+    [[nodiscard]] long lookups() const { return numLookups; }
+
+private:
+    struct Block {
+        std::vector<OperationView> ops;
+        std::vector<char> keyBytes;                 // text traces: the keys of ops
+        std::vector<std::uint32_t> keyEnds;         // where each key ends in keyBytes
+        std::vector<OpCode> tags;
+        bool last = false;
+    };
+
+    Block blocks[NUM_BLOCKS];
+    std::size_t numFull = 0;            // blocks handed over and not yet taken back
+    std::size_t fillIdx = 0;            // the loader's next block
+    std::size_t takeIdx = 0;            // the caller's next block
+    bool holding = false;               // the caller has blocks[takeIdx - 1]
+    bool stopping = false;
+    bool ended = false;
+
+    std::mutex lock;
+    std::condition_variable blockFull, blockFree;
+    std::thread loader;
+
+    bool binary = false;
+    MappedTrace mapped;
+    std::ifstream text;
+    std::vector<char> chunk;
+    std::size_t chunkPos = 0, chunkEnd = 0;
+
+    bool parseFailed = false;
+    std::int64_t loaderBusyNs = 0;
+    std::int64_t consumerStallNs = 0;
+    long numInserts = 0;
+    long numErases = 0;
+    long numLookups = 0;
+
+    void load();
+    bool fillFromText( Block& block );
+    bool fillFromBinary( Block& block, std::size_t& nextOp );
+    bool nextLine( std::string_view& line );
+};
+
+
+#endif //HASHTABLESOPENADDRESSING_TRACESTREAM_HPP
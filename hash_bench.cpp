@@ -0,0 +1,154 @@
+// hash_bench: what hashing a key costs, by key length.
+//
+// Every key of each word list is bucketed by its length, and each hasher is
+// timed over a bucket: one warm-up pass and 7 timed passes, median reported
+// as nanoseconds per key. The *_double rows include everything DOUBLE
+// probing needs (home slot and step); the *_single rows only the home slot.
+//
+// usage: hash_bench [word_list ...]
+// With no arguments the word lists at the top of the repository are used.
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+
+#include "KeyHash.hpp"
+
+// The table size the report's N = 2^20 runs used. Read through a volatile
+// so the compiler can't turn the divisions into multiplications.
+volatile std::size_t benchTableSize = 1310809;
+volatile std::uint64_t benchSink = 0;
+
+std::uint64_t polynomialSingle(const std::string& v, std::size_t tableSize) {
+    return polynomialHash(v, 131, tableSize);
+}
+
+std::uint64_t polynomialDouble(const std::string& v, std::size_t tableSize) {
+    return polynomialHash(v, 131, tableSize) + (1 + polynomialHash(v, 257, tableSize - 1));
+}
+
+// The table reduces with fastmod multipliers it computes once; so do these.
+std::uint64_t tableSizeMultiplier = fastmodMultiplier(1310809);
+std::uint64_t stepRangeMultiplier = fastmodMultiplier(1310808);
+
+std::uint64_t wyhashSingle(const std::string& v, std::size_t tableSize) {
+    const auto T = static_cast<std::uint32_t>(tableSize);
+    return fastmod32(static_cast<std::uint32_t>(wyhash64(v)), tableSizeMultiplier, T);
+}
+
+std::uint64_t wyhashDouble(const std::string& v, std::size_t tableSize) {
+    const auto T = static_cast<std::uint32_t>(tableSize);
+    const std::uint64_t h = wyhash64(v);
+    return fastmod32(static_cast<std::uint32_t>(h), tableSizeMultiplier, T) +
+           (1 + fastmod32(static_cast<std::uint32_t>(h >> 32), stepRangeMultiplier, T - 1));
+}
+
+bool load_words(const std::string& path, std::vector<std::string>& out_words)
+{
+    out_words.clear();
+
+    std::ifstream in(path);
+    if (!in.is_open())
+        return false;
+
+    std::string word;
+    while (in >> word)
+        out_words.push_back(word);
+
+    return true;
+}
+
+// Median ns per key of hashing every key in keys, repeated until a pass
+// is long enough to time. The hasher is a template argument so that it is
+// inlined into the loop, as it is in the tables.
+template<std::uint64_t (*Hash)(const std::string&, std::size_t)>
+double time_hasher(const std::vector<std::string>& keys)
+{
+    using clock = std::chrono::steady_clock;
+
+    const std::size_t tableSize = benchTableSize;
+    const std::size_t repeats = std::max<std::size_t>(1, 200000 / keys.size());
+    std::uint64_t sink = 0;
+
+    auto pass = [&]() {
+        for (std::size_t r = 0; r < repeats; ++r)
+            for (const auto& key : keys)
+                sink += Hash(key, tableSize);
+    };
+
+    // Warm-up (untimed)
+    pass();
+
+    const int numTrials = 7;
+    std::vector<std::int64_t> trials_ns;
+    trials_ns.reserve(numTrials);
+
+    for (int trial = 0; trial < numTrials; ++trial) {
+        auto t0 = clock::now();
+        pass();
+        auto t1 = clock::now();
+        trials_ns.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()
+        );
+    }
+
+    // Keeps the hashing from being optimized away.
+    benchSink = sink;
+
+    const size_t mid = trials_ns.size() / 2;
+    std::nth_element(trials_ns.begin(), trials_ns.begin() + mid, trials_ns.end());
+    return static_cast<double>(trials_ns[mid]) / static_cast<double>(repeats * keys.size());
+}
+
+struct Hasher {
+    const char* name;
+    double (*time)(const std::vector<std::string>& keys);
+};
+
+const std::vector<Hasher> hashers = {
+    {"polynomial_single", time_hasher<polynomialSingle>},
+    {"polynomial_double", time_hasher<polynomialDouble>},
+    {"wyhash_single", time_hasher<wyhashSingle>},
+    {"wyhash_double", time_hasher<wyhashDouble>},
+};
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> wordLists;
+    for (int i = 1; i < argc; ++i)
+        wordLists.emplace_back(argv[i]);
+    if (wordLists.empty())
+        wordLists = {"6770_uniq_words.txt", "50000_words_6770_uniq.txt", "all_uniq_tokens_imdb_and_newsgroups.txt"};
+
+    std::cout << "word_list,key_len,num_keys,hasher,ns_per_key" << std::endl;
+
+    for (const auto& path : wordLists) {
+
+        std::vector<std::string> words;
+        if (!load_words(path, words) || words.empty()) {
+            std::cerr << "Error: failed to read " << path << "\n";
+            continue;
+        }
+
+        std::map<std::size_t, std::vector<std::string>> byLength;
+        for (const auto& word : words)
+            byLength[word.size()].push_back(word);
+
+        for (const auto& hasher : hashers) {
+            for (const auto& [len, keys] : byLength) {
+                std::cout << path << "," << len << "," << keys.size() << "," << hasher.name << ","
+                    << hasher.time(keys) << std::endl;
+            }
+            // Every key of the list, in file order.
+            std::cout << path << ",all," << words.size() << "," << hasher.name << ","
+                << hasher.time(words) << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,301 @@
+// hashtable_bench: what each table operation costs on its own.
+//
+// For every table size 2^10 .. 2^20 (rounded up to a prime), SINGLE and
+// DOUBLE probing, and load factor 0.5 .. 0.95, a table is filled to that
+// load factor once and these are timed on it:
+//
+//   hit_lookup         member() of keys in the table
+//   miss_lookup        member() of keys not in the table
+//   remove             remove() of keys in the table
+//   insert_tombstone   insert() of keys whose own slots are tombstones
+//   insert_fresh       insert() into a table with no tombstones, taking it
+//                      from 0.9 of the load factor up to the load factor
+//   compact            compactTable() of the table with those tombstones;
+//                      an op is one live key re-placed
+//
+// The updates move the same tenth of the keys out and back in, and put
+// the table back as it was after every timed stretch, untimed. Each
+// benchmark runs a warm-up and 7 timed trials of at least MIN_TRIAL_OPS
+// operations; ns per op is reported as the median, mean, standard
+// deviation, minimum and maximum over the trials.
+//
+// The tables are the fixed-policy LinearProbingDictionary and
+// DoubleHashingDictionary, with compaction off so that only
+// compactTable() compacts. The keys are the same on every run.
+//
+// usage: hashtable_bench [--json] [--min-log2 A] [--max-log2 B]
+// --json writes one JSON object with a result per line, so two builds'
+// outputs can be diffed; otherwise the output is CSV.
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+#include "HashTableDictionary.hpp"
+
+volatile std::uint64_t benchSink = 0;
+
+const int numTrials = 7;
+const std::size_t MIN_TRIAL_OPS = 20000;
+const double loadFactors[] = {0.5, 0.6, 0.7, 0.8, 0.9, 0.95};
+
+// compactTable() is protected; the benchmark calls it directly.
+template<class Dict>
+struct BenchTable : Dict {
+    using Dict::Dict;
+    using Dict::compactTable;
+};
+
+struct BenchResult {
+    std::string benchmark;
+    std::string probeType;
+    std::size_t tableSize;
+    double loadFactor;
+    std::size_t opsPerTrial;
+    double median_ns, mean_ns, stddev_ns, min_ns, max_ns;
+};
+
+// Distinct keys, the same on every run: key i is splitmix64(i), a
+// bijection, written in base 36.
+std::vector<std::string> make_keys(std::size_t n)
+{
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (std::uint64_t i = 0; i < n; ++i) {
+        std::uint64_t z = i + 0x9e3779b97f4a7c15ULL * (i + 1);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        z ^= z >> 31;
+        std::string key;
+        do {
+            key.push_back("0123456789abcdefghijklmnopqrstuvwxyz"[z % 36]);
+            z /= 36;
+        } while (z != 0);
+        keys.push_back(std::move(key));
+    }
+    return keys;
+}
+
+// ================================================================
+// time_op: warm-up + numTrials trials. A trial runs reset() and then
+// the timed timed() until at least MIN_TRIAL_OPS operations have been
+// timed; only timed() is on the clock.
+// ================================================================
+template<class Timed, class Reset>
+BenchResult time_op(const char* benchmark, std::size_t opsPerCall, Timed timed, Reset reset)
+{
+    using clock = std::chrono::steady_clock;
+
+    const std::size_t calls = std::max<std::size_t>(1, MIN_TRIAL_OPS / std::max<std::size_t>(opsPerCall, 1));
+    auto trial = [&]() {
+        std::int64_t ns = 0;
+        for (std::size_t c = 0; c < calls; ++c) {
+            reset();
+            auto t0 = clock::now();
+            timed();
+            auto t1 = clock::now();
+            ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        }
+        return static_cast<double>(ns) / static_cast<double>(calls * opsPerCall);
+    };
+
+    // Warm-up (untimed)
+    trial();
+
+    std::vector<double> trials_ns;
+    trials_ns.reserve(numTrials);
+    for (int t = 0; t < numTrials; ++t)
+        trials_ns.push_back(trial());
+
+    BenchResult r{};
+    r.benchmark = benchmark;
+    r.opsPerTrial = calls * opsPerCall;
+
+    double sum = 0.0;
+    for (double ns : trials_ns)
+        sum += ns;
+    r.mean_ns = sum / numTrials;
+    double squares = 0.0;
+    for (double ns : trials_ns)
+        squares += (ns - r.mean_ns) * (ns - r.mean_ns);
+    r.stddev_ns = std::sqrt(squares / (numTrials - 1));
+
+    std::sort(trials_ns.begin(), trials_ns.end());
+    r.median_ns = trials_ns[numTrials / 2];
+    r.min_ns = trials_ns.front();
+    r.max_ns = trials_ns.back();
+    return r;
+}
+
+// ================================================================
+// bench_table: fill one table to loadFactor and time every benchmark
+// on it. present holds the keys in the table, moving the tenth of them
+// the updates take out and put back, absent keys that are never in it.
+// ================================================================
+template<class Dict>
+void bench_table(std::size_t tableSize, typename Dict::PROBE_TYPE probeType, const char* probeName,
+    double loadFactor, const std::vector<std::string>& keys, std::vector<BenchResult>& out_results)
+{
+    BenchTable<Dict> ht(tableSize, probeType, false);
+    const std::size_t slots = ht.stats().tableSize;
+    const auto n = static_cast<std::size_t>(std::llround(loadFactor * static_cast<double>(slots)));
+    const std::size_t m = std::max<std::size_t>(1, n / 10);
+
+    std::vector<std::string> present(keys.begin(), keys.begin() + n);
+    std::vector<std::string> absent(keys.begin() + n, keys.begin() + 2 * n);
+    std::mt19937 rng(23);
+    std::shuffle(present.begin(), present.end(), rng);
+    const std::vector<std::string> moving(present.begin(), present.begin() + m);
+
+    for (const auto& key : present)
+        ht.insert(key);
+
+    auto insertMoving = [&]() { for (const auto& key : moving) ht.insert(key); };
+    auto removeMoving = [&]() { for (const auto& key : moving) ht.remove(key); };
+    auto nothing = []() {};
+
+    std::vector<BenchResult> results;
+
+    // All n keys in, no tombstones.
+    results.push_back(time_op("hit_lookup", n, [&]() {
+        std::uint64_t found = 0;
+        for (const auto& key : present)
+            found += ht.member(key);
+        benchSink = found;
+    }, nothing));
+    results.push_back(time_op("miss_lookup", n, [&]() {
+        std::uint64_t found = 0;
+        for (const auto& key : absent)
+            found += ht.member(key);
+        benchSink = found;
+    }, nothing));
+
+    // Each timed remove leaves m tombstones; putting the keys back
+    // reuses every one of them, since a key's own slot comes before any
+    // free slot on its probe sequence.
+    bool removed = false;
+    results.push_back(time_op("remove", m, [&]() { removeMoving(); removed = true; },
+        [&]() { if (removed) insertMoving(); removed = false; }));
+    insertMoving();
+
+    // m tombstones at the moving keys' slots before each timed insert.
+    results.push_back(time_op("insert_tombstone", m, insertMoving, removeMoving));
+
+    // m tombstones before each compaction; an op is a live key.
+    bool compacted = false;
+    results.push_back(time_op("compact", n - m, [&]() { ht.compactTable(); compacted = true; },
+        [&]() { if (compacted) { insertMoving(); removeMoving(); } }));
+    insertMoving();
+
+    // n - m keys and no tombstones before each timed insert.
+    results.push_back(time_op("insert_fresh", m, insertMoving, [&]() {
+        removeMoving();
+        ht.compactTable();
+    }));
+
+    for (auto& r : results) {
+        r.probeType = probeName;
+        r.tableSize = slots;
+        r.loadFactor = loadFactor;
+        out_results.push_back(std::move(r));
+    }
+}
+
+// ================================================================
+// Output
+// ================================================================
+void print_csv(const std::vector<BenchResult>& results)
+{
+    std::cout << "benchmark,probe_type,table_size,load_factor,ops_per_trial,trials,"
+                 "median_ns,mean_ns,stddev_ns,min_ns,max_ns" << std::endl;
+    for (const auto& r : results) {
+        std::cout << r.benchmark << "," << r.probeType << "," << r.tableSize << "," << r.loadFactor << ","
+            << r.opsPerTrial << "," << numTrials << ","
+            << r.median_ns << "," << r.mean_ns << "," << r.stddev_ns << "," << r.min_ns << "," << r.max_ns
+            << std::endl;
+    }
+}
+
+void print_json(const std::vector<BenchResult>& results)
+{
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(3);
+    os << "{\n";
+    os << "  \"suite\": \"hashtable_bench\",\n";
+#if defined(__VERSION__)
+    os << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+#endif
+#if defined(__OPTIMIZE__)
+    os << "  \"optimized\": true,\n";
+#else
+    os << "  \"optimized\": false,\n";
+#endif
+    os << "  \"trials\": " << numTrials << ",\n";
+    os << "  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        os << "    {\"benchmark\": \"" << r.benchmark << "\", \"probe_type\": \"" << r.probeType
+           << "\", \"table_size\": " << r.tableSize << ", \"load_factor\": " << std::setprecision(2) << r.loadFactor
+           << std::setprecision(3) << ", \"ops_per_trial\": " << r.opsPerTrial
+           << ", \"median_ns\": " << r.median_ns << ", \"mean_ns\": " << r.mean_ns
+           << ", \"stddev_ns\": " << r.stddev_ns << ", \"min_ns\": " << r.min_ns << ", \"max_ns\": " << r.max_ns
+           << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n";
+    os << "}\n";
+    std::cout << os.str();
+}
+
+int main(int argc, char* argv[])
+{
+    bool json = false;
+    int minLog2 = 10, maxLog2 = 20;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--json")
+            json = true;
+        else if (arg == "--min-log2" && i + 1 < argc)
+            minLog2 = std::atoi(argv[++i]);
+        else if (arg == "--max-log2" && i + 1 < argc)
+            maxLog2 = std::atoi(argv[++i]);
+        else {
+            std::cerr << "usage: hashtable_bench [--json] [--min-log2 A] [--max-log2 B]\n";
+            return 1;
+        }
+    }
+    if (minLog2 < 4 || maxLog2 > 26 || minLog2 > maxLog2) {
+        std::cerr << "Error: table sizes must be 2^4 .. 2^26, smallest first.\n";
+        return 1;
+    }
+
+    // Enough keys for the largest table, and as many again for misses.
+    const std::vector<std::string> keys = make_keys(2 * ((std::size_t{1} << maxLog2) + 1024));
+
+    std::vector<BenchResult> results;
+    for (int log2 = minLog2; log2 <= maxLog2; ++log2) {
+        const std::size_t tableSize = std::size_t{1} << log2;
+        for (double loadFactor : loadFactors) {
+            bench_table<LinearProbingDictionary>(tableSize, HashTableCommon::SINGLE, "single", loadFactor,
+                keys, results);
+            bench_table<DoubleHashingDictionary>(tableSize, HashTableCommon::DOUBLE, "double", loadFactor,
+                keys, results);
+        }
+        // Progress, so a long run is visibly alive.
+        std::cerr << "table size 2^" << log2 << " done\n";
+    }
+
+    if (json)
+        print_json(results);
+    else
+        print_csv(results);
+
+    return 0;
+}
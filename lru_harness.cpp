@@ -6,56 +6,327 @@
 #include <filesystem>
 #include <iostream>
 #include <chrono>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
+#include <new>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <iterator>
+#include <cstdint>
+
+#include <pthread.h>
+#include <sched.h>
 
 #include "Operations.hpp"
 #include "RunResults.hpp"
 #include "RunMetaData.hpp"
 #include "HashTableDictionary.hpp"
+#include "LruCache.hpp"
+#include "ClockCache.hpp"
+#include "SwissTableDictionary.hpp"
+#include "ConcurrentHashTableDictionary.hpp"
+#include "TraceFiles.hpp"
+#include "TraceStream.hpp"
+#include "OptimisticHashTableDictionary.hpp"
+#include "PerfCounters.hpp"
 #include "utils/TraceConfig.hpp"
 
+// ================================================================
+// Allocation counter: every operator new in the process bumps it, so
+// run_trace_ops() can report how many allocations a replay made. The
+// per-thread count is the replaying thread's own, which --jobs needs.
+// ================================================================
+std::atomic<std::int64_t> numAllocations{0};
+thread_local std::int64_t threadAllocations = 0;
+
+void* operator new(std::size_t size)
+{
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    ++threadAllocations;
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// ================================================================
+// replay_op: how one trace operation is applied to an implementation
+// ================================================================
+template<class Impl>
+inline void replay_op(Impl& ht, const OperationView& op)
+{
+    if (op.tag == OpCode::Insert) {
+        ht.emplace(op.key);
+    }
+    else if (op.tag == OpCode::Erase) {
+        ht.remove(op.key);
+    }
+    else if (op.tag == OpCode::Lookup) {
+        ht.member(op.key);
+    }
+}
+
+// The Swiss table's insert() already takes a view.
+inline void replay_op(SwissTableDictionary& ht, const OperationView& op)
+{
+    if (op.tag == OpCode::Insert) {
+        ht.insert(op.key);
+    }
+    else if (op.tag == OpCode::Erase) {
+        ht.remove(op.key);
+    }
+    else if (op.tag == OpCode::Lookup) {
+        ht.member(op.key);
+    }
+}
+
+// The trace's I and L lines are the accesses (an L that misses is followed
+// by the I that fills it); its E lines are the evictions the generator's
+// reference LRU made. The cache makes its own evictions, so E lines are
+// skipped here and checked by verify_lru_replay() instead.
+inline void replay_op(LruCache& cache, const OperationView& op)
+{
+    if (op.tag == OpCode::Insert) {
+        cache.put(op.key);
+    }
+    else if (op.tag == OpCode::Lookup) {
+        cache.get(op.key);
+    }
+}
+
+// The CLOCK cache is replayed the same way; its evictions are its own
+// approximation of LRU, so they need not match the trace's E lines.
+inline void replay_op(ClockCache& cache, const OperationView& op)
+{
+    if (op.tag == OpCode::Insert) {
+        cache.put(op.key);
+    }
+    else if (op.tag == OpCode::Lookup) {
+        cache.get(op.key);
+    }
+}
+
+// Whether replay_op() applies the trace's E lines; the caches skip them,
+// so they have no erase latencies to report.
+template<class Impl>
+constexpr bool replays_erases(const Impl&) { return true; }
+constexpr bool replays_erases(const LruCache&) { return false; }
+constexpr bool replays_erases(const ClockCache&) { return false; }
+
+// ================================================================
+// Per-operation latencies (--latency): set once in main(), before any
+// replay starts. Each operation is bracketed by two steady_clock reads,
+// so the percentiles include one clock read; main() reports what that
+// costs on this machine.
+// ================================================================
+bool recordOpLatencies = false;
+
+std::int64_t clock_read_ns()
+{
+    // The smallest gap between back-to-back reads is the cost of one.
+    using clock = std::chrono::steady_clock;
+    std::int64_t best = INT64_MAX;
+    for (int i = 0; i < 10000; i++) {
+        const auto t0 = clock::now();
+        const auto t1 = clock::now();
+        best = std::min<std::int64_t>(best,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    }
+    return best;
+}
+
+// Hardware counters (--counters): set once in main(), like
+// recordOpLatencies. Each timed run is counted, and the median run's
+// counts are reported.
+bool recordHardwareCounters = false;
+
 // ================================================================
 // run_trace_ops: warm-up + 7 timed runs, returns median elapsed_ns
+// and the number of heap allocations the median run made. With
+// --latency, 7 more runs time every operation into a histogram per
+// opcode; the timed runs above stay free of the clock reads.
 // ================================================================
 template<class Impl>
 RunResult run_trace_ops(Impl& ht,
     RunResult& runResult,
-    const std::vector<Operation>& ops)
+    const std::vector<OperationView>& ops)
 {
     using clock = std::chrono::steady_clock;
 
     // Warm-up (untimed)
     ht.clear();
     for (const auto& op : ops) {
-        if (op.tag == OpCode::Insert) {
-            ht.insert(op.key);
-        }
-        else if (op.tag == OpCode::Erase) {
-            ht.remove(op.key);
-        }
+        replay_op(ht, op);
     }
 
-    // Timed trials
+    // With --counters, the hardware counters of this thread; if they
+    // can't be opened, stop() returns counts that are all invalid.
+    PerfCounters counters;
+    if (recordHardwareCounters)
+        counters.open();
+
+    // Timed trials: elapsed_ns, allocations and counts of each run
+    struct Trial {
+        std::int64_t elapsed_ns;
+        std::int64_t allocations;
+        PerfCounts counts;
+    };
     const int numTrials = 7;
-    std::vector<std::int64_t> trials_ns;
+    std::vector<Trial> trials_ns;
     trials_ns.reserve(numTrials);
 
     for (int trial = 0; trial < numTrials; ++trial) {
 
         ht.clear();
 
+        const std::int64_t allocs0 = threadAllocations;
+        counters.start();
         auto t0 = clock::now();
         for (const auto& op : ops) {
-            if (op.tag == OpCode::Insert) {
-                ht.insert(op.key);
-            }
-            else if (op.tag == OpCode::Erase) {
-                ht.remove(op.key);
+            replay_op(ht, op);
+        }
+        auto t1 = clock::now();
+        const PerfCounts counts = counters.stop();
+        const std::int64_t allocs1 = threadAllocations;
+
+        trials_ns.push_back({
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count(),
+            allocs1 - allocs0,
+            counts
+        });
+    }
+
+    // Median
+    const size_t mid = trials_ns.size() / 2;
+    std::nth_element(trials_ns.begin(),
+        trials_ns.begin() + mid,
+        trials_ns.end(),
+        [](const Trial& a, const Trial& b) { return a.elapsed_ns < b.elapsed_ns; });
+    runResult.elapsed_ns = trials_ns[mid].elapsed_ns;
+    runResult.allocations = trials_ns[mid].allocations;
+    runResult.counters = trials_ns[mid].counts;
+
+    if (recordOpLatencies) {
+        // 8 KB each, so not on the stack; one pair per --jobs worker.
+        static thread_local LatencyHistogram insertNs, eraseNs, lookupNs;
+        insertNs.clear();
+        eraseNs.clear();
+        lookupNs.clear();
+        for (int trial = 0; trial < numTrials; ++trial) {
+            ht.clear();
+            for (const auto& op : ops) {
+                const auto t0 = clock::now();
+                replay_op(ht, op);
+                const auto t1 = clock::now();
+                const auto ns = static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+                if (op.tag == OpCode::Insert)
+                    insertNs.record(ns);
+                else if (op.tag == OpCode::Lookup)
+                    lookupNs.record(ns);
+                else if (replays_erases(ht))
+                    eraseNs.record(ns);
             }
         }
+        runResult.insert_latency = insertNs.summary();
+        runResult.erase_latency = eraseNs.summary();
+        runResult.lookup_latency = lookupNs.summary();
+    }
+
+    return runResult;
+}
+
+// ================================================================
+// run_config: time one implementation on one trace, write its CSV row
+// ================================================================
+template<class Impl>
+void run_config(std::ostream& out,
+    Impl& ht,
+    const std::string& impl,
+    const RunMetaData& meta,
+    const std::string& trace_path,
+    long inserts,
+    long erases,
+    long lookups,
+    const std::vector<OperationView>& ops)
+{
+    RunResult r(meta);
+    r.impl = impl;
+    r.trace_path = trace_path;
+    r.inserts = inserts;
+    r.erases = erases;
+    r.lookups = lookups;
+
+    run_trace_ops(ht, r, ops);
+
+    out << r.to_csv_row()
+        << ","
+        << ht.csvStats()
+        << std::endl;
+}
+
+// ================================================================
+// run_batched_ops: the trace replayed through applyBatch() in windows of
+// batchSize operations. Warm-up + 7 timed runs, returns median elapsed_ns
+// ================================================================
+template<class Impl>
+RunResult run_batched_ops(Impl& ht,
+    RunResult& runResult,
+    const std::vector<OperationView>& ops,
+    std::size_t batchSize)
+{
+    using clock = std::chrono::steady_clock;
+
+    // Built once, so the timed loop allocates nothing of its own.
+    std::vector<HashTableCommon::BATCH_OP> batchOps;
+    std::vector<std::string_view> keys;
+    batchOps.reserve(ops.size());
+    keys.reserve(ops.size());
+    for (const auto& op : ops) {
+        batchOps.push_back(op.tag == OpCode::Insert ? HashTableCommon::BATCH_INSERT :
+            op.tag == OpCode::Lookup ? HashTableCommon::BATCH_MEMBER : HashTableCommon::BATCH_REMOVE);
+        keys.emplace_back(op.key);
+    }
+
+    auto replay = [&]() {
+        for (std::size_t i = 0; i < ops.size(); i += batchSize)
+            ht.applyBatch(batchOps.data() + i, keys.data() + i, std::min(batchSize, ops.size() - i));
+    };
+
+    // Warm-up (untimed)
+    ht.clear();
+    replay();
+
+    // Timed trials: (elapsed_ns, allocations)
+    const int numTrials = 7;
+    std::vector<std::pair<std::int64_t, std::int64_t>> trials_ns;
+    trials_ns.reserve(numTrials);
+
+    for (int trial = 0; trial < numTrials; ++trial) {
+
+        ht.clear();
+
+        const std::int64_t allocs0 = numAllocations.load(std::memory_order_relaxed);
+        auto t0 = clock::now();
+        replay();
         auto t1 = clock::now();
+        const std::int64_t allocs1 = numAllocations.load(std::memory_order_relaxed);
 
-        trials_ns.push_back(
-            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()
+        trials_ns.emplace_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count(),
+            allocs1 - allocs0
         );
     }
 
@@ -64,65 +335,616 @@ RunResult run_trace_ops(Impl& ht,
     std::nth_element(trials_ns.begin(),
         trials_ns.begin() + mid,
         trials_ns.end());
-    runResult.elapsed_ns = trials_ns[mid];
+    runResult.elapsed_ns = trials_ns[mid].first;
+    runResult.allocations = trials_ns[mid].second;
 
     return runResult;
 }
 
 // ================================================================
-// Parse trace: header "<profile> <N> <seed>"
-// Then lines: I key   or   E key
+// run_batch_scaling: the probe types replayed in batches of K, for K
+// from 1 (no lookahead) to 64, or for onlyBatchSize if it is not 0
 // ================================================================
-bool load_trace_strict_header(const std::string& path,
-    RunMetaData& runMeta,
-    std::vector<Operation>& out_operations)
+template<class Impl>
+void run_batch_config(Impl& ht,
+    const std::string& impl,
+    const RunMetaData& meta,
+    const std::string& trace_path,
+    long inserts,
+    long erases,
+    long lookups,
+    const std::vector<OperationView>& ops,
+    std::size_t batchSize)
 {
-    out_operations.clear();
+    RunResult r(meta);
+    r.impl = impl;
+    r.trace_path = trace_path;
+    r.inserts = inserts;
+    r.erases = erases;
+    r.lookups = lookups;
 
-    std::ifstream in(path);
-    if (!in.is_open())
-        return false;
+    run_batched_ops(ht, r, ops, batchSize);
 
-    // Header
-    std::string header;
-    if (!std::getline(in, header))
-        return false;
+    std::cout << r.to_csv_row()
+        << "," << batchSize
+        << "," << ht.csvStats()
+        << std::endl;
+}
 
-    std::istringstream hdr(header);
-    if (!(hdr >> runMeta.profile >> runMeta.N >> runMeta.seed))
-        return false;
+void run_batch_scaling(const RunMetaData& meta,
+    const std::string& trace_path,
+    long inserts,
+    long erases,
+    long lookups,
+    const std::vector<OperationView>& ops,
+    std::size_t onlyBatchSize)
+{
+    for (std::size_t batchSize : {1, 2, 4, 8, 16, 32, 64}) {
+        if (onlyBatchSize != 0)
+            batchSize = onlyBatchSize;
+        {
+            HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(meta.N),
+                HashTableDictionary::DOUBLE,
+                true);
+
+            run_batch_config(ht, "hash_map_double", meta, trace_path, inserts, erases, lookups, ops, batchSize);
+        }
+        {
+            HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(meta.N),
+                HashTableDictionary::SINGLE,
+                true);
 
-    // Opcodes
-    std::string line;
-    while (std::getline(in, line)) {
+            run_batch_config(ht, "hash_map_single", meta, trace_path, inserts, erases, lookups, ops, batchSize);
+        }
+        {
+            HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(meta.N),
+                HashTableDictionary::ROBIN_HOOD,
+                false);
 
-        const auto first = line.find_first_not_of(" \t\r\n");
-        if (first == std::string::npos || line[first] == '#')
-            continue;
+            run_batch_config(ht, "hash_map_robin_hood", meta, trace_path, inserts, erases, lookups, ops, batchSize);
+        }
+        {
+            DoubleHashingDictionary ht(HashTableDictionary::tableSizeForCapacity(meta.N),
+                HashTableDictionary::DOUBLE,
+                true);
 
-        std::istringstream iss(line.substr(first));
-        std::string tok, key;
+            run_batch_config(ht, "hash_map_double_nostats", meta, trace_path, inserts, erases, lookups, ops, batchSize);
+        }
+        if (onlyBatchSize != 0)
+            break;
+    }
+}
 
-        if (!(iss >> tok))
-            continue;
+// ================================================================
+// run_threaded_ops: the trace split by key across numThreads threads,
+// each replaying its share in trace order, so every key sees the same
+// sequence of operations as in a single-threaded replay. Warm-up + 7
+// timed runs; returns the median wall time of the replays
+// ================================================================
+template<class Impl>
+RunResult run_threaded_ops(Impl& ht,
+    RunResult& runResult,
+    const std::vector<OperationView>& ops,
+    std::size_t numThreads)
+{
+    using clock = std::chrono::steady_clock;
 
-        if (!(iss >> key))
-            return false;
+    std::vector<std::vector<const OperationView*>> shares(numThreads);
+    for (const auto& op : ops)
+        shares[wyhash64(op.key, 0x5bd1e995u) % numThreads].push_back(&op);
 
-        if (tok == "I") {
-            out_operations.emplace_back(OpCode::Insert, key);
+    // One replay: the threads are started first and released together,
+    // so starting them is not timed.
+    auto replay = [&](std::int64_t& allocations) {
+        std::atomic<std::size_t> ready{0};
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        threads.reserve(numThreads);
+        for (std::size_t t = 0; t < numThreads; ++t) {
+            threads.emplace_back([&, t]() {
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+                for (const OperationView* op : shares[t])
+                    replay_op(ht, *op);
+            });
         }
-        else if (tok == "E") {
-            out_operations.emplace_back(OpCode::Erase, key);
+        while (ready.load() < numThreads)
+            std::this_thread::yield();
+
+        const std::int64_t allocs0 = numAllocations.load(std::memory_order_relaxed);
+        auto t0 = clock::now();
+        go.store(true, std::memory_order_release);
+        for (auto& thread : threads)
+            thread.join();
+        auto t1 = clock::now();
+        allocations = numAllocations.load(std::memory_order_relaxed) - allocs0;
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    };
+
+    // Warm-up (untimed)
+    std::int64_t allocations = 0;
+    ht.clear();
+    replay(allocations);
+
+    // Timed trials: (elapsed_ns, allocations)
+    const int numTrials = 7;
+    std::vector<std::pair<std::int64_t, std::int64_t>> trials_ns;
+    trials_ns.reserve(numTrials);
+
+    for (int trial = 0; trial < numTrials; ++trial) {
+        ht.clear();
+        const std::int64_t elapsed = replay(allocations);
+        trials_ns.emplace_back(elapsed, allocations);
+    }
+
+    // Median
+    const size_t mid = trials_ns.size() / 2;
+    std::nth_element(trials_ns.begin(),
+        trials_ns.begin() + mid,
+        trials_ns.end());
+    runResult.elapsed_ns = trials_ns[mid].first;
+    runResult.allocations = trials_ns[mid].second;
+
+    return runResult;
+}
+
+// ================================================================
+// run_thread_scaling: the concurrent table, and the same table as a
+// single shard behind one lock, replayed from 1 to 64 threads
+// ================================================================
+void run_thread_scaling(const RunMetaData& meta,
+    const std::string& trace_path,
+    long inserts,
+    long erases,
+    long lookups,
+    const std::vector<OperationView>& ops)
+{
+    const std::size_t numShards = 64;
+
+    for (std::size_t numThreads : {1, 2, 4, 8, 16, 32, 64}) {
+        for (std::size_t shards : {numShards, std::size_t{1}}) {
+            ConcurrentHashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(meta.N), shards,
+                HashTableDictionary::DOUBLE,
+                true);
+
+            RunResult r(meta);
+            r.impl = shards == 1 ? "global_lock_hash_map_double" : "concurrent_hash_map_double";
+            r.trace_path = trace_path;
+            r.inserts = inserts;
+            r.erases = erases;
+            r.lookups = lookups;
+
+            run_threaded_ops(ht, r, ops, numThreads);
+
+            std::cout << r.to_csv_row()
+                << "," << numThreads
+                << "," << ht.loadFactor()
+                << "," << ht.csvStats()
+                << std::endl;
+        }
+    }
+}
+
+// ================================================================
+// run_reader_ops: one writer replays the trace while numReaders threads
+// look up the trace's keys, each from its own offset, until the writer
+// is done. Warm-up + 7 timed runs; returns the median writer time and
+// the reader lookups of that run
+// ================================================================
+inline std::int64_t reader_retries(const OptimisticHashTableDictionary& ht) { return ht.readerRetries(); }
+inline std::int64_t reader_retries(const ConcurrentHashTableDictionary&) { return 0; }
+
+template<class Impl>
+std::int64_t run_reader_ops(Impl& ht,
+    RunResult& runResult,
+    const std::vector<OperationView>& ops,
+    std::size_t numReaders)
+{
+    using clock = std::chrono::steady_clock;
+
+    // One replay: (writer ns, allocations, reader lookups)
+    auto replay = [&]() {
+        std::atomic<std::size_t> ready{0};
+        std::atomic<bool> go{false};
+        std::atomic<bool> done{false};
+        std::atomic<std::int64_t> lookups{0};
+        std::vector<std::thread> readers;
+        readers.reserve(numReaders);
+        for (std::size_t r = 0; r < numReaders; ++r) {
+            readers.emplace_back([&, r]() {
+                std::size_t i = ops.size() / numReaders * r;
+                std::int64_t n = 0;
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+                while (!done.load(std::memory_order_relaxed)) {
+                    ht.member(ops[i].key);
+                    ++n;
+                    if (++i == ops.size())
+                        i = 0;
+                }
+                lookups.fetch_add(n);
+            });
+        }
+        while (ready.load() < numReaders)
+            std::this_thread::yield();
+
+        const std::int64_t allocs0 = numAllocations.load(std::memory_order_relaxed);
+        auto t0 = clock::now();
+        go.store(true, std::memory_order_release);
+        for (const auto& op : ops)
+            replay_op(ht, op);
+        auto t1 = clock::now();
+        const std::int64_t allocations = numAllocations.load(std::memory_order_relaxed) - allocs0;
+        done.store(true, std::memory_order_relaxed);
+        for (auto& reader : readers)
+            reader.join();
+
+        return std::make_tuple(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count(),
+            allocations, lookups.load());
+    };
+
+    // Warm-up (untimed)
+    ht.clear();
+    replay();
+
+    const int numTrials = 7;
+    std::vector<std::tuple<std::int64_t, std::int64_t, std::int64_t>> trials_ns;
+    trials_ns.reserve(numTrials);
+
+    for (int trial = 0; trial < numTrials; ++trial) {
+        ht.clear();
+        trials_ns.push_back(replay());
+    }
+
+    // Median
+    const size_t mid = trials_ns.size() / 2;
+    std::nth_element(trials_ns.begin(),
+        trials_ns.begin() + mid,
+        trials_ns.end());
+    runResult.elapsed_ns = std::get<0>(trials_ns[mid]);
+    runResult.allocations = std::get<1>(trials_ns[mid]);
+
+    return std::get<2>(trials_ns[mid]);
+}
+
+// ================================================================
+// run_reader_scaling: the optimistic table, whose readers take no lock,
+// and the sharded concurrent table, with 1 to 64 readers beside the
+// writer
+// ================================================================
+template<class Impl>
+void run_reader_config(Impl& ht,
+    const std::string& impl,
+    const RunMetaData& meta,
+    const std::string& trace_path,
+    long inserts,
+    long erases,
+    long lookups,
+    const std::vector<OperationView>& ops,
+    std::size_t numReaders)
+{
+    RunResult r(meta);
+    r.impl = impl;
+    r.trace_path = trace_path;
+    r.inserts = inserts;
+    r.erases = erases;
+    r.lookups = lookups;
+
+    const std::int64_t readerLookups = run_reader_ops(ht, r, ops, numReaders);
+    const double secs = static_cast<double>(r.elapsed_ns) / 1e9;
+
+    std::cout << r.to_csv_row()
+        << "," << numReaders
+        << "," << readerLookups
+        << "," << static_cast<std::int64_t>(secs > 0.0 ? static_cast<double>(readerLookups) / secs : 0.0)
+        << "," << reader_retries(ht)
+        << "," << ht.loadFactor()
+        << "," << ht.csvStats()
+        << std::endl;
+}
+
+void run_reader_scaling(const RunMetaData& meta,
+    const std::string& trace_path,
+    long inserts,
+    long erases,
+    long lookups,
+    const std::vector<OperationView>& ops)
+{
+    for (std::size_t numReaders : {1, 2, 4, 8, 16, 32, 64}) {
+        {
+            // Grows past the 0.8 load tableSizeForCapacity() sizes for, as
+            // the concurrent table's shards do, so that both run at that load.
+            OptimisticHashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(meta.N),
+                HashTableDictionary::DOUBLE,
+                true, 0.95, 0.9);
+
+            run_reader_config(ht, "optimistic_hash_map_double", meta, trace_path, inserts, erases, lookups, ops, numReaders);
+        }
+        {
+            ConcurrentHashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(meta.N), 64,
+                HashTableDictionary::DOUBLE,
+                true);
+
+            run_reader_config(ht, "concurrent_hash_map_double", meta, trace_path, inserts, erases, lookups, ops, numReaders);
         }
-        else {
+    }
+}
+
+// ================================================================
+// run_streamed_ops: the trace read by a TraceStream while it is
+// replayed, so only a few blocks of it are in memory. Warm-up + 7
+// timed runs. elapsed_ns is the median run's time in the table alone;
+// returns its end-to-end time and the time it waited on the loader
+// ================================================================
+template<class Impl>
+bool run_streamed_ops(Impl& ht,
+    RunResult& runResult,
+    const std::string& path,
+    std::int64_t& endToEndNs,
+    std::int64_t& stallNs)
+{
+    using clock = std::chrono::steady_clock;
+
+    TraceStream stream;
+
+    struct Trial {
+        std::int64_t endToEndNs, tableNs, stallNs, loaderNs, allocations;
+    };
+    auto replay = [&](Trial& trial) {
+        RunMetaData meta;
+        const std::int64_t allocs0 = numAllocations.load(std::memory_order_relaxed);
+        auto t0 = clock::now();
+        if (!stream.start(path, meta))
             return false;
+        std::int64_t tableNs = 0;
+        while (const auto* ops = stream.next()) {
+            auto b0 = clock::now();
+            for (const auto& op : *ops) {
+                replay_op(ht, op);
+            }
+            tableNs += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - b0).count();
         }
+        stream.finish();
+        auto t1 = clock::now();
+        if (stream.failed())
+            return false;
+
+        trial = {std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count(), tableNs,
+            stream.stallNs(), stream.loaderNs(),
+            numAllocations.load(std::memory_order_relaxed) - allocs0};
+        meta.load_ns = trial.loaderNs;
+        runResult.run_meta_data = meta;
+        runResult.inserts = stream.inserts();
+        runResult.erases = stream.erases();
+        runResult.lookups = stream.lookups();
+        return true;
+    };
+
+    // Warm-up (untimed)
+    Trial trial{};
+    ht.clear();
+    if (!replay(trial))
+        return false;
+
+    const int numTrials = 7;
+    std::vector<Trial> trials;
+    trials.reserve(numTrials);
+
+    for (int t = 0; t < numTrials; ++t) {
+        ht.clear();
+        if (!replay(trial))
+            return false;
+        trials.push_back(trial);
     }
 
+    // Median, by end-to-end time
+    const size_t mid = trials.size() / 2;
+    std::nth_element(trials.begin(),
+        trials.begin() + mid,
+        trials.end(),
+        [](const Trial& a, const Trial& b) { return a.endToEndNs < b.endToEndNs; });
+    runResult.elapsed_ns = trials[mid].tableNs;
+    runResult.allocations = trials[mid].allocations;
+    runResult.run_meta_data.load_ns = trials[mid].loaderNs;
+    endToEndNs = trials[mid].endToEndNs;
+    stallNs = trials[mid].stallNs;
+
     return true;
 }
 
+// ================================================================
+// run_stream_scaling: streamed replays; the trace is never loaded whole
+// ================================================================
+template<class Impl>
+void run_stream_config(Impl& ht,
+    const std::string& impl,
+    const std::string& path,
+    const std::string& trace_path)
+{
+    RunResult r(RunMetaData{});
+    r.impl = impl;
+    r.trace_path = trace_path;
+
+    std::int64_t endToEndNs = 0, stallNs = 0;
+    if (!run_streamed_ops(ht, r, path, endToEndNs, stallNs)) {
+        std::cerr << "Error: failed to stream " << path << "\n";
+        return;
+    }
+
+    std::cout << r.to_csv_row()
+        << "," << static_cast<double>(endToEndNs) / 1e6
+        << "," << static_cast<double>(stallNs) / 1e6
+        << "," << ht.csvStats()
+        << std::endl;
+}
+
+void run_stream_scaling(const std::string& path,
+    const std::string& trace_path)
+{
+    // N is in the trace's header, which only the stream reads.
+    RunMetaData meta;
+    {
+        TraceStream header;
+        if (!header.start(path, meta)) {
+            std::cerr << "Error: failed to open " << path << "\n";
+            return;
+        }
+    }
+
+    {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(meta.N),
+            HashTableDictionary::DOUBLE,
+            true);
+
+        run_stream_config(ht, "hash_map_double", path, trace_path);
+    }
+    {
+        DoubleHashingDictionary ht(HashTableDictionary::tableSizeForCapacity(meta.N),
+            HashTableDictionary::DOUBLE,
+            true);
+
+        run_stream_config(ht, "hash_map_double_nostats", path, trace_path);
+    }
+    {
+        LruCache cache(meta.N, HashTableDictionary::tableSizeForCapacity(meta.N),
+            HashTableDictionary::DOUBLE,
+            true);
+
+        run_stream_config(cache, "lru_cache_double", path, trace_path);
+    }
+}
+
+// ================================================================
+// cache_hit_ratio: one more replay, untimed, counting the accesses the
+// way the trace generator made them. Every L line is an access, and so
+// is every I line but the one that follows an L of the same key: that
+// one is the generator's fill of its own miss. The cache fills its own
+// misses instead, so a key the reference LRU kept and this cache did
+// not still gets fetched. (A write straight after a read of the same
+// key looks just like a fill, and is skipped too.)
+// ================================================================
+struct CacheHits {
+    std::int64_t accesses = 0;
+    std::int64_t hits = 0;
+};
+
+template<class Cache>
+CacheHits cache_hit_ratio(Cache& cache, const std::vector<OperationView>& ops)
+{
+    cache.clear();
+
+    CacheHits h;
+    std::string_view lastRead;
+    bool afterRead = false;
+    for (const auto& op : ops) {
+        if (op.tag == OpCode::Lookup) {
+            const bool hit = cache.get(op.key);
+            if (!hit)
+                cache.put(op.key);
+            ++h.accesses;
+            h.hits += hit;
+            lastRead = op.key;
+            afterRead = true;
+        }
+        else if (op.tag == OpCode::Insert) {
+            if (!(afterRead && op.key == lastRead)) {
+                ++h.accesses;
+                h.hits += cache.put(op.key);
+            }
+            afterRead = false;
+        }
+    }
+    return h;
+}
+
+// ================================================================
+// run_cache_comparison: exact LRU against CLOCK, on both probe types.
+// The timing columns compare their throughput; hit_ratio what the
+// approximation costs in hits
+// ================================================================
+template<class Cache>
+void run_cache_config(Cache& cache,
+    const std::string& impl,
+    const RunMetaData& meta,
+    const std::string& trace_path,
+    long inserts,
+    long erases,
+    long lookups,
+    const std::vector<OperationView>& ops)
+{
+    RunResult r(meta);
+    r.impl = impl;
+    r.trace_path = trace_path;
+    r.inserts = inserts;
+    r.erases = erases;
+    r.lookups = lookups;
+
+    run_trace_ops(cache, r, ops);
+    const CacheHits h = cache_hit_ratio(cache, ops);
+
+    std::cout << r.to_csv_row()
+        << "," << h.accesses
+        << "," << h.hits
+        << "," << (h.accesses > 0 ? static_cast<double>(h.hits) / static_cast<double>(h.accesses) : 0.0)
+        << "," << cache.evictions()
+        << "," << cache.csvStats()
+        << std::endl;
+}
+
+void run_cache_comparison(const RunMetaData& meta,
+    const std::string& trace_path,
+    long inserts,
+    long erases,
+    long lookups,
+    const std::vector<OperationView>& ops)
+{
+    for (auto probeType : {HashTableDictionary::DOUBLE, HashTableDictionary::SINGLE}) {
+        const std::string probeName = probeType == HashTableDictionary::DOUBLE ? "double" : "single";
+        {
+            LruCache cache(meta.N, HashTableDictionary::tableSizeForCapacity(meta.N), probeType, true);
+
+            run_cache_config(cache, "lru_cache_" + probeName, meta, trace_path, inserts, erases, lookups, ops);
+        }
+        {
+            ClockCache cache(meta.N, HashTableDictionary::tableSizeForCapacity(meta.N), probeType, true);
+
+            run_cache_config(cache, "clock_cache_" + probeName, meta, trace_path, inserts, erases, lookups, ops);
+        }
+    }
+}
+
+// ================================================================
+// verify_lru_replay: every eviction the cache makes must match the
+// trace's next E line. Returns the number of mismatches.
+// ================================================================
+long verify_lru_replay(LruCache& cache, const std::vector<OperationView>& ops)
+{
+    cache.clear();
+
+    long mismatches = 0;
+    const std::string_view* expectedVictim = nullptr;
+    for (const auto& op : ops) {
+        if (op.tag == OpCode::Erase) {
+            expectedVictim = &op.key;
+            continue;
+        }
+        if (op.tag == OpCode::Lookup) {
+            cache.get(op.key);
+            continue;
+        }
+        cache.put(op.key);
+        if (cache.evictedOnLastPut() != (expectedVictim != nullptr) ||
+            (expectedVictim != nullptr && cache.lastEvicted() != *expectedVictim))
+            ++mismatches;
+        expectedVictim = nullptr;
+    }
+
+    return mismatches;
+}
+
 // ================================================================
 // Find trace files
 // ================================================================
@@ -164,111 +986,527 @@ void find_trace_files_or_die(const std::string& dir,
 }
 
 // ================================================================
-// N -> M table size mapping
+// LoadedTrace: one trace and its counts, loaded once for all the
+// configurations run on it
 // ================================================================
-std::size_t tableSizeForN(std::size_t N)
-{
-    static const std::vector<std::pair<std::size_t, std::size_t>> N_and_primes = {
-        {1024,     1279},
-        {2048,     2551},
-        {4096,     5101},
-        {8192,    10273},
-        {16384,   20479},
-        {32768,   40849},
-        {65536,   81931},
-        {131072,  163861},
-        {262144,  327739},
-        {524288,  655243},
-        {1048576, 1310809}
-    };
+struct LoadedTrace {
+    std::string base;
+    RunMetaData meta;
+    long inserts = 0;
+    long erases = 0;
+    long lookups = 0;
 
-    for (auto item : N_and_primes) {
-        if (item.first == N)
-            return item.second;
+    MappedTrace mappedTrace;
+    std::vector<Operation> textOperations;
+    std::vector<OperationView> operations;
+};
+
+// The binary trace if trace2bin has made one since the text was last
+// written: its keys are read in place from the mapping. Otherwise the
+// text; a binary trace older than the text (lru_tracegen has been run
+// again) is left alone, with a warning on err.
+std::string trace_file_to_load(const std::string& traceFile, std::ostream& err)
+{
+    const std::string binaryFile = binary_trace_path(traceFile);
+    std::error_code ec;
+    const auto binaryTime = std::filesystem::last_write_time(binaryFile, ec);
+    if (ec)
+        return traceFile;
+    const auto textTime = std::filesystem::last_write_time(traceFile, ec);
+    if (!ec && binaryTime < textTime) {
+        err << "Warning: " << binaryFile << " is older than " << traceFile
+            << "; replaying the text. Run trace2bin again to update it.\n";
+        return traceFile;
     }
+    return binaryFile;
+}
 
-    std::cerr << "Error: invalid N = " << N << "\n";
-    std::exit(1);
+std::string trace_base_name(const std::string& path)
+{
+    const auto pos = path.find_last_of("/\\");
+    return (pos == std::string::npos) ? path : path.substr(pos + 1);
 }
 
-int main()
+// ================================================================
+// load_trace: map the binary trace, or parse the text into Operations
+// that the views point into. Returns false (after a message on err) if
+// the trace can't be loaded.
+// ================================================================
+bool load_trace(const std::string& traceFile, LoadedTrace& trace, std::ostream& err)
 {
-    const std::string profileName = "lru_profile";
-    const std::string traceDir = "traceFiles/" + profileName;
+    const std::string loadedFile = trace_file_to_load(traceFile, err);
+    trace.base = trace_base_name(loadedFile);
 
-    std::vector<std::string> traceFiles;
-    find_trace_files_or_die(traceDir, profileName, traceFiles);
+    const auto load0 = std::chrono::steady_clock::now();
+    if (loadedFile != traceFile) {
+        if (!trace.mappedTrace.open(loadedFile, trace.meta, trace.operations)) {
+            err << "Error: failed to load " << loadedFile << "\n";
+            return false;
+        }
+    } else {
+        if (!load_trace_strict_header(traceFile, trace.meta, trace.textOperations)) {
+            err << "Error: failed to parse " << traceFile << "\n";
+            return false;
+        }
+        trace.operations.reserve(trace.textOperations.size());
+        for (const auto& op : trace.textOperations)
+            trace.operations.emplace_back(op);
+    }
+    trace.meta.load_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - load0).count();
 
-    if (traceFiles.empty()) {
-        std::cerr << "No trace files found.\n";
-        return 1;
+    for (const auto& op : trace.operations) {
+        if (op.tag == OpCode::Insert) ++trace.inserts;
+        else if (op.tag == OpCode::Erase) ++trace.erases;
+        else if (op.tag == OpCode::Lookup) ++trace.lookups;
     }
+    return true;
+}
 
-    std::cout << RunResult::csv_header()
-        << ","
-        << HashTableDictionary::csvStatsHeader()
-        << std::endl;
+// ================================================================
+// The default configurations, in the order their rows are printed. Each
+// builds its table and writes its rows to io.out, warnings to io.err.
+// ================================================================
+struct JobStreams {
+    std::ostream& out;
+    std::ostream& err;
+};
 
-    for (const auto& traceFile : traceFiles) {
+using ConfigFn = void (*)(JobStreams& io, const LoadedTrace& trace);
 
-        const auto pos = traceFile.find_last_of("/\\");
-        const std::string base =
-            (pos == std::string::npos) ? traceFile : traceFile.substr(pos + 1);
+const ConfigFn defaultConfigs[] = {
+    // DOUBLE probing
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::DOUBLE,
+            true);
 
-        std::vector<Operation> operations;
-        RunMetaData meta;
+        run_config(io.out, ht, "hash_map_double", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+
+    // SINGLE probing
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::SINGLE,
+            true);
+
+        run_config(io.out, ht, "hash_map_single", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+
+    // DOUBLE and SINGLE probing with the original per-character hashes
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::DOUBLE,
+            true);
+        ht.setHashType(HashTableDictionary::POLYNOMIAL);
+
+        run_config(io.out, ht, "hash_map_double_polynomial", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::SINGLE,
+            true);
+        ht.setHashType(HashTableDictionary::POLYNOMIAL);
+
+        run_config(io.out, ht, "hash_map_single_polynomial", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+
+    // DOUBLE probing with the keys in one arena instead of a string per slot
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::DOUBLE,
+            true);
+        ht.setKeyStorage(HashTableDictionary::ARENA);
+
+        run_config(io.out, ht, "hash_map_double_arena", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+    // ... and compacting in place: once warmed up, the replay allocates nothing
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::DOUBLE,
+            true, 0.95, HashTableDictionary::IN_PLACE);
+        ht.setKeyStorage(HashTableDictionary::ARENA);
+
+        run_config(io.out, ht, "hash_map_double_arena_in_place", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+
+    // SINGLE probing with backward-shift deletes; no tombstones either
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::SINGLE,
+            false);
+        ht.setDeleteType(HashTableDictionary::BACKWARD_SHIFT);
+
+        run_config(io.out, ht, "hash_map_single_backward_shift", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+
+    // ROBIN_HOOD probing; it leaves no tombstones, so nothing to compact
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::ROBIN_HOOD,
+            false);
+
+        run_config(io.out, ht, "hash_map_robin_hood", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+
+    // The same three probe types with the probe fixed at compile time
+    // and no statistics; their counter columns are left empty
+    [](JobStreams& io, const LoadedTrace& trace) {
+        DoubleHashingDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::DOUBLE,
+            true);
+
+        run_config(io.out, ht, "hash_map_double_nostats", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+    [](JobStreams& io, const LoadedTrace& trace) {
+        LinearProbingDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::SINGLE,
+            true);
+
+        run_config(io.out, ht, "hash_map_single_nostats", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+    [](JobStreams& io, const LoadedTrace& trace) {
+        RobinHoodDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::ROBIN_HOOD,
+            false);
 
-        if (!load_trace_strict_header(traceFile, meta, operations)) {
-            std::cerr << "Error: failed to parse " << traceFile << "\n";
+        run_config(io.out, ht, "hash_map_robin_hood_nostats", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+
+    // Swiss-table layout: control bytes, 16-slot groups
+    [](JobStreams& io, const LoadedTrace& trace) {
+        SwissTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            true);
+
+        run_config(io.out, ht, "swiss_table", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+    // The power-of-two Swiss table runs at about half the load of the
+    // prime tables above; this is DOUBLE probing at the Swiss table's load
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(SwissTableDictionary::groupTableSize(HashTableDictionary::tableSizeForCapacity(trace.meta.N)),
+            HashTableDictionary::DOUBLE,
+            true);
+
+        run_config(io.out, ht, "hash_map_double_swiss_load", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+
+    // DOUBLE and SINGLE probing, incremental compaction
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::DOUBLE,
+            true, 0.95, HashTableDictionary::INCREMENTAL);
+
+        run_config(io.out, ht, "hash_map_double_incremental", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::SINGLE,
+            true, 0.95, HashTableDictionary::INCREMENTAL);
+
+        run_config(io.out, ht, "hash_map_single_incremental", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+
+    // DOUBLE and SINGLE probing, in-place compaction
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::DOUBLE,
+            true, 0.95, HashTableDictionary::IN_PLACE);
+
+        run_config(io.out, ht, "hash_map_double_in_place", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::SINGLE,
+            true, 0.95, HashTableDictionary::IN_PLACE);
+
+        run_config(io.out, ht, "hash_map_single_in_place", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+
+    // Tables sized for N/16 keys that grow (and shrink) as the trace
+    // needs; every trial starts from the small size again
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(std::max<std::size_t>(trace.meta.N / 16, 1)),
+            HashTableDictionary::DOUBLE,
+            true, 0.95, HashTableDictionary::INCREMENTAL);
+        ht.setAutoResize(0.8, 0.2);
+
+        run_config(io.out, ht, "hash_map_double_growing", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(std::max<std::size_t>(trace.meta.N / 16, 1)),
+            HashTableDictionary::SINGLE,
+            true, 0.95, HashTableDictionary::INCREMENTAL);
+        ht.setAutoResize(0.8, 0.2);
+
+        run_config(io.out, ht, "hash_map_single_growing", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+    [](JobStreams& io, const LoadedTrace& trace) {
+        HashTableDictionary ht(HashTableDictionary::tableSizeForCapacity(std::max<std::size_t>(trace.meta.N / 16, 1)),
+            HashTableDictionary::ROBIN_HOOD,
+            false);
+        ht.setAutoResize(0.8, 0.2);
+
+        run_config(io.out, ht, "hash_map_robin_hood_growing", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+    },
+
+    // LRU cache on the DOUBLE probing table
+    [](JobStreams& io, const LoadedTrace& trace) {
+        LruCache cache(trace.meta.N, HashTableDictionary::tableSizeForCapacity(trace.meta.N),
+            HashTableDictionary::DOUBLE,
+            true);
+
+        run_config(io.out, cache, "lru_cache_double", trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+
+        const long mismatches = verify_lru_replay(cache, trace.operations);
+        if (mismatches != 0) {
+            io.err << "Warning: " << trace.base << ": " << mismatches
+                << " evictions differ from the trace.\n";
+        }
+    },
+};
+
+// ================================================================
+// pin_to_cpu: run the calling thread on the i-th CPU it may use (wrapping
+// around if there are fewer). What it allocates afterwards is then
+// first touched, and so placed, on that CPU's NUMA node.
+// ================================================================
+void pin_to_cpu(std::size_t i)
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0)
+        return;
+
+    const int target = static_cast<int>(i % static_cast<std::size_t>(CPU_COUNT(&allowed)));
+    int seen = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed))
             continue;
+        if (seen++ == target) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+            return;
         }
+    }
+}
+
+// ================================================================
+// run_default_configs: every default configuration on every trace. Job
+// j is configuration j % numConfigs on trace j / numConfigs, the order
+// of a serial run.
+//
+// With numJobs > 1, that many pinned workers take the jobs in order.
+// Each loads the traces it needs itself, after pinning, so its copy and
+// the tables it builds are in its own node's memory; a worker keeps only
+// the trace it used last. Every job writes to its own buffers, and the
+// rows are printed in job order as the jobs finish, so the output is the
+// serial run's but for the timings. Jobs still share the memory system,
+// so their timings are noisier than serial ones.
+// ================================================================
+void run_default_configs(const std::vector<std::string>& traceFiles, unsigned numJobs)
+{
+    const std::size_t numConfigs = std::size(defaultConfigs);
+    const std::size_t totalJobs = traceFiles.size() * numConfigs;
 
-        long inserts = 0;
-        long erases = 0;
-        for (const auto& op : operations) {
-            if (op.tag == OpCode::Insert) ++inserts;
-            else if (op.tag == OpCode::Erase) ++erases;
+    // A worker's last trace. A trace that fails to load is reported by
+    // its first configuration's job only.
+    struct TraceCache {
+        std::size_t traceIdx = SIZE_MAX;
+        std::unique_ptr<LoadedTrace> trace;
+        std::string loadError;
+    };
+
+    auto runJob = [&](std::size_t job, TraceCache& cache, std::ostream& out, std::ostream& err) {
+        const std::size_t traceIdx = job / numConfigs;
+        const std::size_t config = job % numConfigs;
+        if (cache.traceIdx != traceIdx) {
+            cache.traceIdx = traceIdx;
+            cache.trace = std::make_unique<LoadedTrace>();
+            std::ostringstream loadErr;
+            if (!load_trace(traceFiles[traceIdx], *cache.trace, loadErr))
+                cache.trace.reset();
+            cache.loadError = loadErr.str();
         }
+        if (cache.trace == nullptr) {
+            if (config == 0)
+                err << cache.loadError;
+            return;
+        }
+        JobStreams io{out, err};
+        defaultConfigs[config](io, *cache.trace);
+    };
 
-        // DOUBLE probing
-        {
-            RunResult r(meta);
-            r.impl = "hash_map_double";
-            r.trace_path = base;
-            r.inserts = inserts;
-            r.erases = erases;
+    if (numJobs <= 1) {
+        TraceCache cache;
+        for (std::size_t job = 0; job < totalJobs; job++)
+            runJob(job, cache, std::cout, std::cerr);
+        return;
+    }
 
-            HashTableDictionary ht(tableSizeForN(meta.N),
-                HashTableDictionary::DOUBLE,
-                true);
+    struct JobOutput {
+        std::string out, err;
+        bool done = false;
+    };
+    std::vector<JobOutput> outputs(totalJobs);
+    std::mutex lock;
+    std::condition_variable jobDone;
+    std::atomic<std::size_t> nextJob{0};
 
-            run_trace_ops(ht, r, operations);
+    std::vector<std::thread> workers;
+    workers.reserve(numJobs);
+    for (unsigned w = 0; w < numJobs; w++) {
+        workers.emplace_back([&, w] {
+            pin_to_cpu(w);
+            TraceCache cache;
+            for (;;) {
+                const std::size_t job = nextJob.fetch_add(1, std::memory_order_relaxed);
+                if (job >= totalJobs)
+                    return;
+                std::ostringstream out, err;
+                runJob(job, cache, out, err);
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    outputs[job].out = out.str();
+                    outputs[job].err = err.str();
+                    outputs[job].done = true;
+                }
+                jobDone.notify_one();
+            }
+        });
+    }
 
-            std::cout << r.to_csv_row()
-                << ","
-                << ht.csvStats()
-                << std::endl;
+    for (std::size_t job = 0; job < totalJobs; job++) {
+        JobOutput output;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            jobDone.wait(guard, [&] { return outputs[job].done; });
+            output = std::move(outputs[job]);
         }
+        std::cout << output.out << std::flush;
+        std::cerr << output.err;
+    }
 
-        // SINGLE probing
-        {
-            RunResult r(meta);
-            r.impl = "hash_map_single";
-            r.trace_path = base;
-            r.inserts = inserts;
-            r.erases = erases;
+    for (auto& worker : workers)
+        worker.join();
+}
 
-            HashTableDictionary ht(tableSizeForN(meta.N),
-                HashTableDictionary::SINGLE,
-                true);
+// usage: lru_harness [--jobs W | --latency | --counters | --threads | --readers | --batch [K] | --stream
+//                     | --caches] [--profile NAME]
+// With no mode, every default configuration is timed on every trace in
+// traceFiles/NAME, lru_profile unless --profile (always last) names
+// another of lru_tracegen's profiles. L lines are member() lookups, or
+// get()s on the LRU cache, and are counted in the lookups column.
+// The insert_, erase_ and lookup_ percentile columns are empty except with
+// --latency, which also times every operation (see run_trace_ops()).
+// Likewise the hardware counter columns, cycles_per_op to
+// branch_misses_per_op, except with --counters; those stay empty for
+// any event the machine can't count.
+// --jobs runs W of those at a time on pinned workers (see
+// run_default_configs()); the rows are the same, in the same order.
+// --threads replays every trace from 1 to 64 threads through the
+// concurrent table instead (see run_thread_scaling()); its rows have
+// threads and load_factor (the shards' combined, at the end of the run)
+// columns after branch_misses_per_op.
+// --readers runs 1 to 64 lookup threads beside one writer (see
+// run_reader_scaling()); its rows have readers, reader_lookups,
+// reader_lookups_per_sec, reader_retries and load_factor (the table's
+// at the end of the run) columns after branch_misses_per_op.
+// --batch replays every trace in batches of K operations (see
+// run_batch_scaling()), for K = 1 to 64 unless K is given; its rows have
+// a batch column after branch_misses_per_op.
+// --stream replays every trace while a loader thread reads it (see
+// run_stream_scaling()); elapsed_ms is the time in the table, and its
+// rows have end_to_end_ms and stall_ms columns after branch_misses_per_op.
+// --caches compares the LRU cache with the CLOCK cache (see
+// run_cache_comparison()); its rows have accesses, cache_hits, hit_ratio
+// and evictions columns after branch_misses_per_op.
+int main(int argc, char* argv[])
+{
+    std::string profileName = "lru_profile";
+    if (argc > 2 && std::string(argv[argc - 2]) == "--profile") {
+        profileName = argv[argc - 1];
+        argc -= 2;
+    }
+
+    const std::string mode = argc > 1 ? argv[1] : "";
+    const bool batchGiven = mode == "--batch" && argc > 2;
+    const std::size_t batchSize = batchGiven ? std::strtoul(argv[2], nullptr, 10) : 0;
+    const unsigned numJobs = mode == "--jobs" && argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1;
+    if ((!mode.empty() && mode != "--jobs" && mode != "--latency" && mode != "--counters" &&
+            mode != "--threads" && mode != "--readers" && mode != "--batch" && mode != "--stream" &&
+            mode != "--caches") ||
+        (batchGiven && batchSize == 0) || numJobs == 0) {
+        std::cerr << "usage: lru_harness [--jobs W | --latency | --counters | --threads | --readers | --batch [K] | --stream"
+            " | --caches] [--profile NAME]\n";
+        return 1;
+    }
 
-            run_trace_ops(ht, r, operations);
+    const std::string traceDir = "traceFiles/" + profileName;
 
-            std::cout << r.to_csv_row()
-                << ","
-                << ht.csvStats()
-                << std::endl;
+    std::vector<std::string> traceFiles;
+    find_trace_files_or_die(traceDir, profileName, traceFiles);
+
+    if (traceFiles.empty()) {
+        std::cerr << "No trace files found.\n";
+        return 1;
+    }
+
+    std::cout << RunResult::csv_header()
+        << (mode == "--threads" ? ",threads,load_factor," :
+            mode == "--readers" ? ",readers,reader_lookups,reader_lookups_per_sec,reader_retries,load_factor," :
+            mode == "--batch" ? ",batch," :
+            mode == "--stream" ? ",end_to_end_ms,stall_ms," :
+            mode == "--caches" ? ",accesses,cache_hits,hit_ratio,evictions," : ",")
+        << HashTableDictionary::csvStatsHeader()
+        << std::endl;
+
+    if (mode == "--latency") {
+        recordOpLatencies = true;
+        std::cerr << "Latencies include one clock read, about "
+            << clock_read_ns() << " ns here.\n";
+    }
+    if (mode == "--counters") {
+        // Open them once to say what this machine can count; the runs
+        // go ahead either way.
+        PerfCounters probe;
+        if (!probe.open()) {
+            std::cerr << "Hardware counters unavailable (" << probe.error()
+                << "); their columns are left empty.\n";
+        } else {
+            for (int e = 0; e < PerfCounts::NUM_EVENTS; e++)
+                if (!probe.counts(static_cast<PerfCounts::EVENT>(e)))
+                    std::cerr << "No counter for " << PerfCounts::columnName(static_cast<PerfCounts::EVENT>(e))
+                        << "; its column is left empty.\n";
+            recordHardwareCounters = true;
+        }
+    }
+    if (mode.empty() || mode == "--jobs" || mode == "--latency" || mode == "--counters") {
+        run_default_configs(traceFiles, numJobs);
+        return 0;
+    }
+
+    for (const auto& traceFile : traceFiles) {
+
+        if (mode == "--stream") {
+            const std::string loadedFile = trace_file_to_load(traceFile, std::cerr);
+            run_stream_scaling(loadedFile, trace_base_name(loadedFile));
+            continue;
         }
+
+        LoadedTrace trace;
+        if (!load_trace(traceFile, trace, std::cerr))
+            continue;
+
+        if (mode == "--threads")
+            run_thread_scaling(trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+        else if (mode == "--readers")
+            run_reader_scaling(trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
+        else if (mode == "--batch")
+            run_batch_scaling(trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations, batchSize);
+        else if (mode == "--caches")
+            run_cache_comparison(trace.meta, trace.base, trace.inserts, trace.erases, trace.lookups, trace.operations);
     }
 
     return 0;
@@ -3,16 +3,18 @@
 #include <string>
 #include <vector>
 #include <list>
-#include <unordered_map>
 #include <algorithm>
+#include <numeric>
+#include <filesystem>
 #include <random>
+#include <cmath>
 #include <cstdlib>
 
 #include "utils/TraceConfig.hpp"
 
 static const std::string WORD_LIST_PATH = "20980712_uniq_words.txt";
 
-void loadFirst4NWords(std::size_t n, std::vector<std::string>& uniqueWords) {
+void loadFirstWords(std::size_t count, std::vector<std::string>& uniqueWords) {
     std::ifstream in(WORD_LIST_PATH);
     if (!in.is_open()) {
         std::cerr << "Failed to open word list file: " << WORD_LIST_PATH << std::endl;
@@ -20,45 +22,48 @@ void loadFirst4NWords(std::size_t n, std::vector<std::string>& uniqueWords) {
     }
 
     uniqueWords.clear();
-    uniqueWords.reserve(4 * n);
+    uniqueWords.reserve(count);
 
     std::string line;
-    while (uniqueWords.size() < 4 * n && std::getline(in, line)) {
+    while (uniqueWords.size() < count && std::getline(in, line)) {
         if (!line.empty())
             uniqueWords.push_back(line);
     }
 
-    if (uniqueWords.size() < 4 * n) {
-        std::cerr << "Word list does not contain enough lines for N = " << n << std::endl;
+    if (uniqueWords.size() < count) {
+        std::cerr << "Word list does not contain " << count << " lines" << std::endl;
         std::exit(1);
     }
 }
 
-void buildAccessBag(const std::vector<std::string>& uniqueWords,
-    std::size_t n,
-    std::vector<std::string>& bag)
+// ================================================================
+// The access patterns. Each returns config.accessesPerN * n accesses,
+// as indices into the first config.keysPerN * n words.
+// ================================================================
+void buildAccessBag(std::size_t n,
+    std::vector<std::size_t>& bag)
 {
     bag.clear();
     bag.reserve(12 * n);
 
     // First N words: appear once
     for (std::size_t i = 0; i < n; ++i)
-        bag.push_back(uniqueWords[i]);
+        bag.push_back(i);
 
     // Second N words: appear five times
     for (std::size_t i = n; i < 2 * n; ++i)
         for (int r = 0; r < 5; ++r)
-            bag.push_back(uniqueWords[i]);
+            bag.push_back(i);
 
     // Third N words: appear three times
     for (std::size_t i = 2 * n; i < 3 * n; ++i)
         for (int r = 0; r < 3; ++r)
-            bag.push_back(uniqueWords[i]);
+            bag.push_back(i);
 
     // Fourth N words: appear three times
     for (std::size_t i = 3 * n; i < 4 * n; ++i)
         for (int r = 0; r < 3; ++r)
-            bag.push_back(uniqueWords[i]);
+            bag.push_back(i);
 
     if (bag.size() != 12 * n) {
         std::cerr << "Internal error: bag size is " << bag.size()
@@ -67,6 +72,104 @@ void buildAccessBag(const std::vector<std::string>& uniqueWords,
     }
 }
 
+// Draws keys by Zipfian popularity. The popularity order is a shuffle of
+// the keys, so the hot keys are not the first words of the list.
+class ZipfianKeys {
+
+public:
+    ZipfianKeys(std::size_t numKeys, double skew, std::mt19937& rng) : byRank(numKeys), cumulative(numKeys) {
+        std::iota(byRank.begin(), byRank.end(), std::size_t{0});
+        std::shuffle(byRank.begin(), byRank.end(), rng);
+        double total = 0.0;
+        for (std::size_t k = 0; k < numKeys; ++k) {
+            total += 1.0 / std::pow(static_cast<double>(k + 1), skew);
+            cumulative[k] = total;
+        }
+    }
+
+    std::size_t next(std::mt19937& rng) {
+        const double u = std::uniform_real_distribution<double>(0.0, cumulative.back())(rng);
+        const auto rank = static_cast<std::size_t>(
+            std::upper_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin());
+        return byRank[std::min(rank, byRank.size() - 1)];
+    }
+
+private:
+    std::vector<std::size_t> byRank;
+    std::vector<double> cumulative;
+};
+
+void buildAccesses(std::size_t n,
+    const TraceConfig& config,
+    std::mt19937& rng,
+    std::vector<std::size_t>& accesses)
+{
+    const std::size_t numKeys = config.keysPerN * n;
+    const std::size_t numAccesses = config.accessesPerN * n;
+
+    if (config.pattern == TraceConfig::LRU_BAG) {
+        buildAccessBag(n, accesses);
+        std::shuffle(accesses.begin(), accesses.end(), rng);
+        return;
+    }
+
+    accesses.clear();
+    accesses.reserve(numAccesses);
+    std::uniform_int_distribution<std::size_t> anyKey(0, numKeys - 1);
+
+    if (config.pattern == TraceConfig::ZIPFIAN) {
+        ZipfianKeys zipf(numKeys, config.zipfSkew, rng);
+        while (accesses.size() < numAccesses)
+            accesses.push_back(zipf.next(rng));
+    }
+    else if (config.pattern == TraceConfig::SHIFTING_HOT_SET) {
+        // The hot set is a window of a shuffled key order, placed anew
+        // at the start of every lifetime.
+        std::vector<std::size_t> order(numKeys);
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        std::shuffle(order.begin(), order.end(), rng);
+        const auto hotSize = std::max<std::size_t>(1, static_cast<std::size_t>(config.hotSetFraction * static_cast<double>(n)));
+        const auto lifetime = std::max<std::size_t>(1, static_cast<std::size_t>(config.hotSetLifetime * static_cast<double>(n)));
+        std::uniform_int_distribution<std::size_t> inHotSet(0, hotSize - 1);
+        std::bernoulli_distribution toHotSet(config.hotAccessFraction);
+
+        std::size_t hotStart = 0;
+        while (accesses.size() < numAccesses) {
+            if (accesses.size() % lifetime == 0)
+                hotStart = anyKey(rng);
+            if (toHotSet(rng))
+                accesses.push_back(order[(hotStart + inHotSet(rng)) % numKeys]);
+            else
+                accesses.push_back(anyKey(rng));
+        }
+    }
+    else {
+        // SCAN_BURSTS: Zipfian traffic, interrupted by scans of
+        // consecutive words, which are mostly cold.
+        ZipfianKeys zipf(numKeys, config.zipfSkew, rng);
+        const auto every = std::max<std::size_t>(1, static_cast<std::size_t>(config.scanEvery * static_cast<double>(n)));
+        const auto length = static_cast<std::size_t>(config.scanLength * static_cast<double>(n));
+
+        std::size_t nextScan = every;
+        while (accesses.size() < numAccesses) {
+            if (accesses.size() >= nextScan) {
+                const std::size_t start = anyKey(rng);
+                for (std::size_t i = 0; i < length && accesses.size() < numAccesses; ++i)
+                    accesses.push_back((start + i) % numKeys);
+                nextScan += every;
+                continue;
+            }
+            accesses.push_back(zipf.next(rng));
+        }
+    }
+}
+
+// ================================================================
+// generateTrace: replay the accesses against a reference LRU cache of
+// n keys and write what it does. A write is "I key"; a read is "L key",
+// and on a miss the fetched key is inserted like a write. A miss on a
+// full cache writes "E victim" first.
+// ================================================================
 void generateTrace(unsigned int seed,
     std::size_t n,
     TraceConfig& config,
@@ -84,50 +187,87 @@ void generateTrace(unsigned int seed,
     out << config.profileName << " " << n << " " << seed << "\n";
 
     std::vector<std::string> uniqueWords;
-    loadFirst4NWords(n, uniqueWords);
+    loadFirstWords(config.keysPerN * n, uniqueWords);
 
-    std::vector<std::string> bag;
-    buildAccessBag(uniqueWords, n, bag);
+    std::vector<std::size_t> accesses;
+    buildAccesses(n, config, rng, accesses);
 
+    std::list<std::size_t> lruList;
+    std::vector<std::list<std::size_t>::iterator> position(uniqueWords.size());
+    std::vector<bool> resident(uniqueWords.size(), false);
 
-    std::shuffle(bag.begin(), bag.end(), rng);
+    // No draws for an all-write profile, so lru_profile's traces stay the
+    // same as they have always been.
+    std::bernoulli_distribution isRead(config.readFraction);
 
-    std::list<std::string> lruList;
-    std::unordered_map<std::string, std::list<std::string>::iterator> residentMap;
+    for (std::size_t k : accesses) {
+        const std::string& w = uniqueWords[k];
+        const bool read = config.readFraction > 0.0 && isRead(rng);
+        if (read)
+            out << "L " << w << "\n";
 
-    for (const std::string& w : bag) {
+        if (resident[k]) {
+            lruList.splice(lruList.begin(), lruList, position[k]);
+            if (!read)
+                out << "I " << w << "\n";
+            continue;
+        }
 
-        auto it = residentMap.find(w);
+        if (lruList.size() == n) {
+            const std::size_t victim = lruList.back();
+            out << "E " << uniqueWords[victim] << "\n";
 
-        if (it != residentMap.end()) {
-            lruList.splice(lruList.begin(), lruList, it->second);
-            out << "I " << w << "\n";
+            resident[victim] = false;
+            lruList.pop_back();
         }
-        else {
-            if (residentMap.size() < n) {
-                lruList.push_front(w);
-                residentMap[w] = lruList.begin();
-                out << "I " << w << "\n";
-            }
-            else {
-                const std::string& victim = lruList.back();
-                out << "E " << victim << "\n";
-
-                residentMap.erase(victim);
-                lruList.pop_back();
 
-                lruList.push_front(w);
-                residentMap[w] = lruList.begin();
+        lruList.push_front(k);
+        position[k] = lruList.begin();
+        resident[k] = true;
 
-                out << "I " << w << "\n";
-            }
-        }
+        out << "I " << w << "\n";
     }
 }
 
-int main() {
+// usage: lru_tracegen [profile] [--reads R] [--skew S]
+// profile is one of TraceConfig::profileNames(), lru_profile by default.
+// --reads sets the fraction of accesses that are reads, --skew the
+// Zipfian skew, overriding the profile's defaults; the traces keep the
+// profile's name.
+int main(int argc, char* argv[]) {
     TraceConfig config("lru_profile");
 
+    auto usage = []() {
+        std::cerr << "usage: lru_tracegen [";
+        const auto names = TraceConfig::profileNames();
+        for (std::size_t i = 0; i < names.size(); ++i)
+            std::cerr << (i == 0 ? "" : " | ") << names[i];
+        std::cerr << "] [--reads R] [--skew S]" << std::endl;
+        std::exit(1);
+    };
+
+    int arg = 1;
+    if (arg < argc && argv[arg][0] != '-') {
+        if (!config.setProfile(argv[arg]))
+            usage();
+        arg++;
+    }
+    for (; arg < argc; arg++) {
+        const std::string flag = argv[arg];
+        if (arg + 1 == argc)
+            usage();
+        const double value = std::strtod(argv[++arg], nullptr);
+        if (flag == "--reads" && value >= 0.0 && value <= 1.0)
+            config.readFraction = value;
+        else if (flag == "--skew" && value >= 0.0)
+            config.zipfSkew = value;
+        else
+            usage();
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(config.traceDirectory + "/" + config.profileName, ec);
+
     for (unsigned seed : config.seeds) {
         std::mt19937 rng(seed);
 
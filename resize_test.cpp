@@ -0,0 +1,156 @@
+// resize_test: checks that HashTableDictionary grows without a pause
+// proportional to the table size, and without ever giving up on an insert.
+//
+//   drain_bound   an INCREMENTAL-compaction table with setAutoResize()
+//                 under insert/remove churn, so that grows come due while
+//                 a compaction is draining. No operation may move the
+//                 drain on by more than compactionSlotsPerStep slots.
+//   full_table    tables without setAutoResize() filled past their size,
+//                 for every probe type and both hashes.
+//
+// Every key is checked against a std::set as the test goes. Prints one
+// line per check and exits 1 on the first failure.
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <set>
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+
+#include "HashTableDictionary.hpp"
+
+// Reads the drain's state, which the table keeps to itself.
+class DrainProbe : public HashTableDictionary {
+public:
+    using HashTableDictionary::HashTableDictionary;
+
+    struct State {
+        bool compacting;
+        std::size_t cursor;
+        std::size_t sourceSize;
+        std::int64_t drainId;   // counts the drains started
+    };
+    [[nodiscard]] State state() const {
+        return {compacting, compactionCursor, sourceTableMask.size(), numCompactions + numResizes};
+    }
+    [[nodiscard]] bool growDue() const {
+        return static_cast<double>(numberOfActive) / static_cast<double>(TABLE_SIZE) > growLoadFactor;
+    }
+    [[nodiscard]] std::size_t slotsPerStep() const { return compactionSlotsPerStep; }
+};
+
+static void fail(const std::string& check, const std::string& why) {
+    std::cout << check << ": FAILED, " << why << std::endl;
+    std::exit(1);
+}
+
+static std::string key(std::uint64_t i) {
+    return "key_" + std::to_string(i * 2654435761u % 1000003u) + "_" + std::to_string(i);
+}
+
+// Source slots the drain went over in one operation.
+static std::size_t drained(const DrainProbe::State& before, const DrainProbe::State& after) {
+    if (!before.compacting)
+        return after.compacting ? after.cursor : 0;
+    if (after.compacting && after.drainId == before.drainId)
+        return after.cursor - before.cursor;
+    // The drain finished, and another may have started.
+    return before.sourceSize - before.cursor + (after.compacting ? after.cursor : 0);
+}
+
+static void drain_bound() {
+    const std::string check = "drain_bound";
+    DrainProbe ht(211, HashTableDictionary::DOUBLE, true, 0.7, HashTableDictionary::INCREMENTAL, 8);
+    ht.setAutoResize(0.8);
+
+    std::set<std::string> expected;
+    std::size_t maxDrained = 0;
+    long growsDeferred = 0;
+    std::uint64_t next = 0, oldest = 0;
+    for (int op = 0; op < 200000; op++) {
+        // Two inserts to every remove: the table keeps growing, and the
+        // removes leave the tombstones that set off compactions.
+        const auto before = ht.state();
+        if (op % 3 == 2) {
+            const std::string k = key(oldest++);
+            if (ht.remove(k) != (expected.erase(k) == 1))
+                fail(check, "remove(" + k + ") disagrees with the reference set");
+        } else {
+            const std::string k = key(next++);
+            if (!ht.insert(k) || !expected.insert(k).second)
+                fail(check, "insert(" + k + ") of a new key failed");
+        }
+        const auto after = ht.state();
+
+        maxDrained = std::max(maxDrained, drained(before, after));
+        if (after.compacting && ht.growDue())
+            growsDeferred++;
+    }
+
+    for (const auto& k : expected)
+        if (!ht.member(k))
+            fail(check, k + " is missing");
+    if (ht.size() != expected.size())
+        fail(check, "size() is " + std::to_string(ht.size()) + ", not " + std::to_string(expected.size()));
+
+    const auto stats = ht.stats();
+    if (maxDrained > ht.slotsPerStep())
+        fail(check, "an operation drained " + std::to_string(maxDrained) + " slots; the bound is " +
+             std::to_string(ht.slotsPerStep()));
+    if (stats.resizes == 0 || stats.compactions == 0 || growsDeferred == 0)
+        fail(check, "no grow came due during a drain (" + std::to_string(stats.resizes) + " resizes, " +
+             std::to_string(stats.compactions) + " compactions)");
+
+    std::cout << check << ": ok, " << stats.resizes << " resizes, " << stats.compactions << " compactions, "
+              << growsDeferred << " operations with a grow waiting on a drain, at most "
+              << maxDrained << " slots drained per operation" << std::endl;
+}
+
+static void full_table(HashTableDictionary::PROBE_TYPE probeType, HashTableDictionary::HASH_TYPE hashType,
+    const std::string& name) {
+    const std::string check = "full_table_" + name;
+    HashTableDictionary ht(11, probeType, false);
+    ht.setHashType(hashType);
+
+    std::vector<std::string> keys;
+    for (std::uint64_t i = 0; i < 1000; i++) {
+        keys.push_back(key(i));
+        if (!ht.insert(keys.back()))
+            fail(check, "insert(" + keys.back() + ") of a new key failed");
+    }
+    for (const auto& k : keys)
+        if (!ht.member(k))
+            fail(check, k + " is missing");
+
+    const auto stats = ht.stats();
+    if (stats.resizes == 0 || ht.size() != keys.size())
+        fail(check, "the table did not grow to hold every key");
+
+    // The same keys in batches, whose hash codes are taken before the
+    // table grows under them.
+    HashTableDictionary batched(11, probeType, false);
+    batched.setHashType(hashType);
+    const std::vector<std::string_view> views(keys.begin(), keys.end());
+    std::unique_ptr<bool[]> inserted(new bool[views.size()]), found(new bool[views.size()]);
+    batched.insertBatch(views.data(), views.size(), inserted.get());
+    batched.memberBatch(views.data(), views.size(), found.get());
+    for (std::size_t i = 0; i < views.size(); i++)
+        if (!inserted[i] || !found[i])
+            fail(check, "batched " + keys[i] + " was not inserted and found");
+    std::cout << check << ": ok, " << stats.resizes << " resizes to " << stats.tableSize << " slots" << std::endl;
+}
+
+int main() {
+    drain_bound();
+    full_table(HashTableDictionary::SINGLE, HashTableDictionary::WYHASH, "single_wyhash");
+    full_table(HashTableDictionary::DOUBLE, HashTableDictionary::WYHASH, "double_wyhash");
+    full_table(HashTableDictionary::ROBIN_HOOD, HashTableDictionary::WYHASH, "robin_hood_wyhash");
+    full_table(HashTableDictionary::SINGLE, HashTableDictionary::POLYNOMIAL, "single_polynomial");
+    full_table(HashTableDictionary::DOUBLE, HashTableDictionary::POLYNOMIAL, "double_polynomial");
+    full_table(HashTableDictionary::ROBIN_HOOD, HashTableDictionary::POLYNOMIAL, "robin_hood_polynomial");
+    return 0;
+}
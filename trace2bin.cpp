@@ -0,0 +1,54 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+#include "TraceFiles.hpp"
+
+// usage: trace2bin [trace ...]
+// Writes x.btrace next to every x.trace given, or next to every trace in
+// traceFiles/lru_profile if none is. lru_harness loads the binary trace
+// when there is one.
+int main(int argc, char* argv[])
+{
+    namespace fs = std::filesystem;
+
+    std::vector<std::string> traceFiles(argv + 1, argv + argc);
+    if (traceFiles.empty()) {
+        const std::string traceDir = "traceFiles/lru_profile";
+        std::error_code ec;
+        if (!fs::is_directory(traceDir, ec)) {
+            std::cerr << "Error: trace directory '" << traceDir << "' not found.\n";
+            return 1;
+        }
+        for (const auto& entry : fs::directory_iterator(traceDir))
+            if (entry.is_regular_file(ec) && entry.path().extension() == ".trace")
+                traceFiles.push_back(entry.path().string());
+        std::sort(traceFiles.begin(), traceFiles.end());
+    }
+
+    int failures = 0;
+    for (const auto& traceFile : traceFiles) {
+        RunMetaData meta;
+        std::vector<Operation> operations;
+        if (!load_trace_strict_header(traceFile, meta, operations)) {
+            std::cerr << "Error: failed to parse " << traceFile << "\n";
+            ++failures;
+            continue;
+        }
+
+        const std::string binaryFile = binary_trace_path(traceFile);
+        if (!write_binary_trace(binaryFile, meta, operations)) {
+            std::cerr << "Error: failed to write " << binaryFile << "\n";
+            ++failures;
+            continue;
+        }
+
+        std::error_code ec;
+        std::cout << binaryFile << ": " << operations.size() << " operations, "
+            << fs::file_size(traceFile, ec) << " -> " << fs::file_size(binaryFile, ec) << " bytes\n";
+    }
+
+    return failures == 0 ? 0 : 1;
+}